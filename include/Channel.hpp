@@ -5,8 +5,8 @@ class Channel
 {
     private:
         /* member variables */
-        std::vector<Client *>   	_channelClients;
-        std::vector<Client *>   	_channelOperators;
+        MemberTable             	_members;
+        size_t                  	_operatorCount;
         std::string             	_channelName;
         std::string             	_channelPassword;
         std::string             	_channelTopic;
@@ -16,7 +16,6 @@ class Channel
         bool                    	_channelIsTopicRestricted;
         bool                    	_channelIsKeyProtected;
         bool                    	_channelIsLimitRestricted;
-        size_t                  	_channelClientCount;
         size_t                  	_channelClientLimit;
         
 
@@ -24,6 +23,11 @@ class Channel
         /* construcotrs & destructors */
         Channel(const std::string name);
         ~Channel(void);
+
+        /* allocated from a SlabPool */
+        static void                 *operator new(size_t size);
+        static void                 operator delete(void *block);
+        static SlabPool             &pool(void);
         
         /* accessors */
         bool                        isInviteOnly(void) const;
@@ -31,8 +35,8 @@ class Channel
         bool                        isKeyProtected(void) const;
         bool                        isLimitRestricted(void) const;
 
-        std::vector<Client*>&       getClients(void);
-        std::vector<Client*>&       getOperators(void);
+        const MemberTable&          getMembers(void) const;
+        size_t                      getOperatorCount(void) const;
         std::string                 getName(void) const;
         std::string                 getPasskey(void) const;
         std::string                 getTopic(void) const;
@@ -40,24 +44,25 @@ class Channel
         std::string                 getTopicSetAt(void) const;
         size_t                      getClientLimit(void) const;
         size_t                      getClientCount(void) const;
-        size_t                      incClientCount(void);
-        size_t                      decClientCount(void);
 
         void                        setName(std::string &name);
         void                        setPassword(std::string &password);
         void                        setTopic(std::string &topic, const std::string &nickname);
         void                        setModeI(std::string &mode, Client &client);
         void                        setModeT(std::string &mode, Client &client);
-        void                        setModeK(std::vector<std::string> &msgData, Client &client);
-        void                        setModeO(std::vector<std::string> &msgData, Client &client, Server &server);
-        void                        setModeL(std::vector<std::string> &msgData, Client &client);
+        void                        setModeK(std::string &mode, const std::string &key, Client &client);
+        void                        setModeO(std::string &mode, const std::string &nickname, Client &client, Server &server);
+        void                        setModeL(std::string &mode, const std::string &limit, Client &client);
         
         /* member functions */
         bool    isEmpty(void) const;
         bool    hasClient(Client* client) const;
+        Membership  *findMember(const Client *client) const;
+        Membership  *addMember(Client *client, int flags);
+        void    removeMember(Membership *member);
         void    addChanOp(Client* client);
         void    removeChanOp(Client* client);
         bool    isClientChanOp(Client* client) const;
-        void    broadcast(std::string message);
-        void    broadcastSilent(std::string message, Client *client);
+        void    broadcast(const Reply &message);
+        void    broadcastSilent(const Reply &message, Client *client);
 };
@@ -9,8 +9,8 @@ class ChannelManager
     protected:
     
     public:
-        typedef std::map<std::string, Channel *>    channels_t;
-        typedef std::pair<std::string, Channel *>   channel_pair_t;
+        /* keyed by casefolded name; Channel objects never move */
+        typedef HashMap<Channel *>                  channels_t;
 
         /* construcotrs & destructors */
         ChannelManager(Server& server);
@@ -32,7 +32,7 @@ class ChannelManager
         void	    addToChannel(std::string &channelName, std::string &channelKey, Client &client);
         bool        channelExists(const std::string& channelName) const;
         void        inviteClient(std::string &channelName, std::string &nickname, Client &client);
-        void        setChanMode(std::vector<std::string> &msgData, Client &client);
+        void        setChanMode(const IrcMessage &msg, Client &client);
         bool        chanRestrictionsFail(Client& client, const std::string& channelName, std::string &channelKey);
 		void        forwardPrivateMessage(std::string &channelName, std::string &message, Client &client);
 
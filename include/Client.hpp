@@ -3,37 +3,69 @@
 
 class Channel;
 class ChannelManager;
+class EventLoop;
 
 class Client
 {
 	private:
+		void						_updatePrefix(void);
+
 		std::string					_username;
 		std::string 				_nickname;
 		std::string 				_fullname;
 		std::string 				_hostname;
+		std::string 				_prefix;
 		std::string 				_IP;
 		pollfd						_socket;
+		EventLoop*					_loop;
+		SendQueue					_sendQueue;
+		SendQueue					_outgoing;
+		InputBuffer					_input;
+		TokenBucket					_lineTokens;
+		TokenBucket					_byteTokens;
+		size_t						_sendqLimit;
+		size_t						_throttledPos;
 
 		bool						_isRegistered;
 		bool 						_isIRCOp;
 		bool						_isBot;
+		bool						_isDisconnected;
+		bool						_isDirty;
+		bool						_isThrottled;
+		bool						_isSendqExceeded;
 
-		std::vector<Channel*>   	_clientChannels;
+		std::vector<Membership *>	_memberships;
 		std::vector<std::string>   	_clientChannelInvites;
 		
 	public:
 
 		/* construcotrs & destructors */
-		Client(pollfd clientSocket);
+		Client(pollfd clientSocket, size_t inputSize);
 		~Client(void);
 
-		std::string msgBuffer;
+		/* allocated from a SlabPool */
+		static void		*operator new(size_t size);
+		static void		operator delete(void *block);
+		static SlabPool	&pool(void);
         
         /* accessors */
-		std::vector<Channel*>&  	getClientChannels();
+		const std::vector<Membership *>&	getMemberships(void) const;
 		std::vector<std::string> 	getChannelInvites() const;
 		int 			getFd(void) const;
 		struct pollfd 	getSocket(void) const;
+		EventLoop*		getLoop(void) const;
+		void			setLoop(EventLoop *loop);
+		void			setEvents(short events);
+		SendQueue&		getSendQueue(void);
+		SendQueue&		getOutgoing(void);
+		size_t			queuedBytes(void) const;
+		InputBuffer&	getInput(void);
+		TokenBucket&	getLineTokens(void);
+		TokenBucket&	getByteTokens(void);
+		size_t			getSendqLimit(void) const;
+		void			setSendqLimit(size_t limit);
+		size_t			getThrottledPos(void) const;
+		void			setThrottledPos(size_t pos);
 		
 		void			setIP(std::string IP);
 		void 			setFullName(std::string &fullname);
@@ -44,23 +76,36 @@ class Client
 		void 			setIRCOp(bool status);
 
 		void			setBot(bool status);
+		void			setDisconnected(bool status);
+		void			setDirty(bool status);
+		void			setThrottled(bool status);
+		void			setSendqExceeded(bool status);
 		void			addChannelInvite(const std::string& channelName);
 		void			delChannelInvite(const std::string& channelName);
-		void			assignUserData(std::string &username, std::string &hostname, std::string &IP, std::string &fullName);
+		void			assignUserData(std::string &hostname, std::string &IP, std::string &fullName);
 
-		std::string 	username(void) const;
-		std::string 	nickname(void) const;
-		std::string 	hostname(void) const;
+		const std::string	&username(void) const;
+		const std::string	&nickname(void) const;
+		const std::string	&hostname(void) const;
+		const std::string	&prefix(void) const;
 
 		bool			isRegistered(void) const;
 		bool 			isIRCOp(void) const;
 		bool			isBot(void) const;
+		bool			isDisconnected(void) const;
+		bool			isDirty(void) const;
+		bool			isThrottled(void) const;
+		bool			isSendqExceeded(void) const;
 		bool 			isChanOp(const std::string &channelName, ChannelManager &manager) const;
         bool	        isInvited(const std::string& channelName) const;
 		
 		/* member functions */
-		void    		joinChannel(ChannelManager& manager, std::string channelName);
-        void    		popClientChannel(ChannelManager& manager, std::string channelName);
+		SendQueue&		takeOutput(void);
+		void			addMembership(Membership *member);
+		void			dropMembership(Membership *member);
+		bool			hasTokens(uint64_t now);
+		void			spendTokens(size_t lines, size_t bytes);
+		uint64_t		tokenDelay(void) const;
 		
 
 };
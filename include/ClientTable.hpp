@@ -0,0 +1,34 @@
+#ifndef CLIENT_TABLE_HPP
+#define CLIENT_TABLE_HPP
+
+#include <vector>
+#include <cstddef>
+
+class Client;
+
+/*
+** Every connected client, kept densely packed for iteration. A table indexed
+** by fd gives each client's position, so lookup, insertion and removal are
+** O(1): removal moves the last client into the freed position.
+** Iteration order is therefore not connection order.
+*/
+class ClientTable
+{
+	private:
+		std::vector<Client *>	_clients;
+		std::vector<int>		_position;
+
+	public:
+		ClientTable(void);
+		~ClientTable(void);
+
+		size_t	size(void) const;
+		bool	empty(void) const;
+		Client	*operator[](size_t i) const;
+
+		Client	*find(int fd) const;
+		void	insert(Client *client);
+		void	erase(int fd);
+};
+
+#endif
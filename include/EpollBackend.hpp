@@ -0,0 +1,27 @@
+#ifndef EPOLL_BACKEND_HPP
+#define EPOLL_BACKEND_HPP
+
+#include "EventBackend.hpp"
+#include <sys/epoll.h>
+
+class EpollBackend : public EventBackend
+{
+	private:
+		int							_epollFd;
+		std::vector<epoll_event>	_events;
+		std::vector<void *>			_data;
+		size_t						_registered;
+
+	public:
+		EpollBackend(void);
+		~EpollBackend(void);
+
+		bool		isOpen(void) const;
+		const char	*name(void) const;
+		bool		add(int fd, short events, void *data);
+		bool		modify(int fd, short events, void *data);
+		void		remove(int fd);
+		int			wait(std::vector<IOEvent> &ready, int timeout);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef EVENT_BACKEND_HPP
+#define EVENT_BACKEND_HPP
+
+#include <string>
+#include <vector>
+#include <poll.h>
+
+class SendQueue;
+class Server;
+
+/* Completion bits, only reported by backends that perform the I/O */
+#define IO_ACCEPTED	0x1000
+#define IO_RECEIVED	0x2000
+#define IO_SENT		0x4000
+
+/*
+** One notification handed back by EventBackend::wait().
+** `events` uses the poll(2) bits (POLLIN, POLLOUT, POLLHUP, POLLERR, POLLNVAL)
+** whatever the backend, and `data` is the pointer given at registration
+** (the Client* for client sockets, NULL for server-owned sockets).
+**
+** Completion backends report finished operations instead of readiness:
+** IO_ACCEPTED carries the new fd (or -errno) in `result`, IO_RECEIVED the byte count (or
+** 0 / -errno) in `result` with the bytes in `buffer`, valid until the next
+** wait(), and IO_SENT the byte count or -errno of the last send().
+*/
+struct IOEvent
+{
+	int			fd;
+	short		events;
+	void		*data;
+	int			result;
+	const char	*buffer;
+};
+
+class EventBackend
+{
+	public:
+		virtual ~EventBackend(void) {}
+
+		virtual const char	*name(void) const = 0;
+		virtual bool		add(int fd, short events, void *data) = 0;
+		virtual bool		modify(int fd, short events, void *data) = 0;
+		virtual void		remove(int fd) = 0;
+		virtual int			wait(std::vector<IOEvent> &ready, int timeout) = 0;
+
+		/* readiness backends leave accept(), read() and writes to the caller */
+		virtual bool		completesIO(void) const { return (false); }
+		virtual bool		listen(int fd) { return (add(fd, POLLIN, NULL)); }
+		virtual bool		send(int fd, SendQueue &queue) { (void)fd; (void)queue; return (false); }
+		virtual size_t		pendingSends(void) const { return (0); }
+
+		static EventBackend	*create(const Server &server);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include "irc.hpp"
+#include <pthread.h>
+
+class Server;
+class Client;
+
+/*
+** One event-loop shard: its own listening socket (SO_REUSEPORT when there
+** is more than one shard), its own backend and the clients it accepted.
+**
+** Channels, nicknames and the client registry live in Server and are shared
+** by every shard. A shard only touches them while holding the server state
+** lock, so commands are handled one at a time across all shards, and a
+** PRIVMSG handled on one shard queues its line for members owned by another.
+** Sockets are only read and written by their owner, without the lock: the
+** owner moves a dirty client's queued output aside under the lock, sends it
+** once the lock is released, and settles what went out under the lock again.
+** Closing a socket and freeing its Client is always left to the owning
+** shard: other shards queue the client with release() and wake it.
+*/
+class EventLoop
+{
+	private:
+		Server&					_server;
+		size_t					_id;
+		int						_listenFd;
+		int						_wakeFd;
+		EventBackend*			_backend;
+		pthread_t				_thread;
+		pthread_t				_handle;
+		size_t					_sendqPause;
+		std::vector<IOEvent>	_ready;
+		std::vector<ssize_t>	_readResults;
+		std::vector<Client *>	_closing;
+		std::vector<Client *>	_dirty;
+		std::vector<Client *>	_flushing;
+		std::vector<Client *>	_failed;
+		size_t					_written;
+		size_t					_shortWrites;
+		std::vector<Client *>	_throttled;
+		uint64_t				_resumeAt;
+		std::vector<Client *>	_disconnected;
+		std::vector<pollfd>		_pendingFds;
+
+		void	_openListener(unsigned int port, bool reusePort);
+		void	_readReady(void);
+		void	_dispatchReady(void);
+		void	_applyInterest(Client *client);
+		bool	_flushClient(Client *client);
+		void	_countSent(Client *client, size_t sent);
+		void	_flushDirty(void);
+		void	_sendFlushing(void);
+		void	_settleFlushing(void);
+		void	_resumeThrottled(void);
+		void	_unthrottle(Client *client);
+		int		_waitTimeout(void) const;
+		void	_closeReleased(void);
+		void	_watchPending(void);
+		void	_reapDisconnected(void);
+
+		static void	*_threadMain(void *loop);
+
+	public:
+		EventLoop(Server &server, size_t id, unsigned int port, bool reusePort);
+		~EventLoop(void);
+
+		size_t			getId(void) const;
+		int				getListenFd(void) const;
+		EventBackend&	getBackend(void);
+		bool			isCurrentThread(void) const;
+
+		void			watch(Client *client);
+		void			watchFd(int fd, short events);
+		void			release(Client *client);
+		void			markDirty(Client *client);
+		void			throttle(Client *client);
+		void			wake(void);
+		void			run(void);
+		void			drain(void);
+		void			start(void);
+		void			join(void);
+};
+
+#endif
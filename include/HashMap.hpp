@@ -0,0 +1,212 @@
+#ifndef HASH_MAP_HPP
+#define HASH_MAP_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+/*
+** RFC 1459 case mapping: besides A-Z, the characters []\^ are the upper case
+** of {}|~, so "Nick[a]" and "nick{A}" name the same client.
+*/
+inline char	ircFold(char c)
+{
+	if ((c >= 'A' && c <= 'Z') || c == '[' || c == ']' || c == '\\' || c == '^')
+		return (c + 32);
+	return (c);
+}
+
+inline std::string	ircCasefold(const std::string &name)
+{
+	std::string	folded(name);
+	for (size_t i = 0; i < folded.size(); i++)
+		folded[i] = ircFold(folded[i]);
+	return (folded);
+}
+
+/* FNV-1a over the case-folded bytes */
+inline size_t	ircHash(const char *name, size_t length)
+{
+	size_t	hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<unsigned char>(ircFold(name[i]));
+		hash *= 16777619u;
+	}
+	return (hash);
+}
+
+/*
+** Open-addressing hash table keyed by IRC names, compared under the RFC 1459
+** case mapping. Keys are stored case-folded; lookups fold the probe on the
+** fly, so finding a name never allocates. Linear probing over a power of two
+** table kept under 3/4 full, and removal shifts the following entries back
+** instead of leaving tombstones, so probe runs stay short under churn.
+**
+** find() returns a pointer to the stored value, valid until the next insert
+** or erase.
+*/
+template <typename T>
+class HashMap
+{
+	private:
+		struct Slot
+		{
+			std::string	key;
+			T			value;
+			size_t		hash;
+			bool		used;
+
+			Slot(void) : value(), hash(0), used(false) {}
+		};
+
+		std::vector<Slot>	_slots;
+		size_t				_size;
+
+		size_t	_mask(void) const { return (_slots.size() - 1); }
+		bool	_matches(const Slot &slot, size_t hash, const char *key, size_t length) const;
+		size_t	_probe(const char *key, size_t length, size_t hash) const;
+		void	_grow(void);
+
+	public:
+		HashMap(void);
+
+		size_t	size(void) const { return (_size); }
+		bool	empty(void) const { return (_size == 0); }
+
+		T		*find(const char *key, size_t length);
+		T		*find(const std::string &key) { return (find(key.data(), key.size())); }
+		const T	*find(const std::string &key) const;
+		T		&operator[](const std::string &key);
+		bool	erase(const std::string &key);
+		void	clear(void);
+
+		/* slot-level iteration, in no particular order */
+		size_t				capacity(void) const { return (_slots.size()); }
+		bool				occupied(size_t i) const { return (_slots[i].used); }
+		const std::string	&keyAt(size_t i) const { return (_slots[i].key); }
+		T					&valueAt(size_t i) { return (_slots[i].value); }
+		const T				&valueAt(size_t i) const { return (_slots[i].value); }
+};
+
+template <typename T>
+HashMap<T>::HashMap(void) : _slots(16), _size(0) {}
+
+template <typename T>
+bool	HashMap<T>::_matches(const Slot &slot, size_t hash, const char *key, size_t length) const
+{
+	if (slot.hash != hash || slot.key.size() != length)
+		return (false);
+	for (size_t i = 0; i < length; i++)
+	{
+		if (slot.key[i] != ircFold(key[i]))
+			return (false);
+	}
+	return (true);
+}
+
+/* Index of the key's slot, or of the free slot that ends its probe run */
+template <typename T>
+size_t	HashMap<T>::_probe(const char *key, size_t length, size_t hash) const
+{
+	size_t	i = hash & _mask();
+
+	while (_slots[i].used && !_matches(_slots[i], hash, key, length))
+		i = (i + 1) & _mask();
+	return (i);
+}
+
+template <typename T>
+void	HashMap<T>::_grow(void)
+{
+	std::vector<Slot>	old(_slots.size() * 2);
+
+	old.swap(_slots);
+	for (size_t i = 0; i < old.size(); i++)
+	{
+		if (!old[i].used)
+			continue ;
+		size_t	j = old[i].hash & _mask();
+		while (_slots[j].used)
+			j = (j + 1) & _mask();
+		_slots[j].key.swap(old[i].key);
+		std::swap(_slots[j].value, old[i].value);
+		_slots[j].hash = old[i].hash;
+		_slots[j].used = true;
+	}
+}
+
+template <typename T>
+T	*HashMap<T>::find(const char *key, size_t length)
+{
+	Slot	&slot = _slots[_probe(key, length, ircHash(key, length))];
+	return (slot.used ? &slot.value : NULL);
+}
+
+template <typename T>
+const T	*HashMap<T>::find(const std::string &key) const
+{
+	const Slot	&slot = _slots[_probe(key.data(), key.size(), ircHash(key.data(), key.size()))];
+	return (slot.used ? &slot.value : NULL);
+}
+
+/* Inserts a default-constructed value when the key is missing */
+template <typename T>
+T	&HashMap<T>::operator[](const std::string &key)
+{
+	size_t	hash = ircHash(key.data(), key.size());
+	size_t	i = _probe(key.data(), key.size(), hash);
+
+	if (_slots[i].used)
+		return (_slots[i].value);
+	if ((_size + 1) * 4 > _slots.size() * 3)
+	{
+		_grow();
+		i = _probe(key.data(), key.size(), hash);
+	}
+	_slots[i].key = ircCasefold(key);
+	_slots[i].value = T();
+	_slots[i].hash = hash;
+	_slots[i].used = true;
+	_size++;
+	return (_slots[i].value);
+}
+
+template <typename T>
+bool	HashMap<T>::erase(const std::string &key)
+{
+	size_t	i = _probe(key.data(), key.size(), ircHash(key.data(), key.size()));
+	if (!_slots[i].used)
+		return (false);
+
+	size_t	j = i;
+	while (true)
+	{
+		j = (j + 1) & _mask();
+		if (!_slots[j].used)
+			break ;
+		size_t	home = _slots[j].hash & _mask();
+		bool	stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+		if (stays)
+			continue ;
+		_slots[i].key.swap(_slots[j].key);
+		std::swap(_slots[i].value, _slots[j].value);
+		_slots[i].hash = _slots[j].hash;
+		i = j;
+	}
+	_slots[i].key.clear();
+	_slots[i].value = T();
+	_slots[i].used = false;
+	_size--;
+	return (true);
+}
+
+template <typename T>
+void	HashMap<T>::clear(void)
+{
+	std::vector<Slot>(16).swap(_slots);
+	_size = 0;
+}
+
+#endif
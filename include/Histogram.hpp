@@ -0,0 +1,49 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <cstddef>
+#include <stdint.h>
+#include <time.h>
+
+#define HISTOGRAM_SUB_BITS	4
+#define HISTOGRAM_SUB		(1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS	((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB)
+
+/*
+** Log-linear histogram in the HDR style: every power of two is split into
+** 16 equal buckets, so any recorded value is known to within 1/16 (6%)
+** whatever its magnitude, in a fixed 4KB table. Recording is a shift, a
+** count-leading-zeros and an increment; percentiles walk the table.
+**
+** Not synchronized: recorded and read under the server state lock.
+*/
+class Histogram
+{
+	private:
+		uint32_t	_counts[HISTOGRAM_BUCKETS];
+		uint64_t	_total;
+		uint64_t	_max;
+
+		static size_t	_bucket(uint64_t value);
+		static uint64_t	_upperBound(size_t bucket);
+
+	public:
+		Histogram(void);
+
+		uint64_t	count(void) const;
+		uint64_t	max(void) const;
+
+		void		record(uint64_t value);
+		uint64_t	percentile(double quantile) const;
+};
+
+/* Nanoseconds on the monotonic clock */
+inline uint64_t	monotonicNs(void)
+{
+	timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (static_cast<uint64_t>(now.tv_sec) * 1000000000u + now.tv_nsec);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef INPUT_BUFFER_HPP
+#define INPUT_BUFFER_HPP
+
+#include <cstddef>
+#include "StringView.hpp"
+
+class SlabPool;
+
+/*
+** Bytes received from a client and not parsed yet, in one fixed-size block
+** (recv_buffer_size). Reads land directly after the received bytes and
+** complete lines are returned as views into the block, so a line is never
+** copied before parsing. Consuming a line only moves an offset; the
+** unparsed tail is moved back to the front when the block runs out of room,
+** so each byte moves at most once per refill.
+*/
+class InputBuffer
+{
+	private:
+		char	*_data;
+		size_t	_capacity;
+		size_t	_start;
+		size_t	_end;
+		size_t	_scanned;
+		bool	_discarding;
+		bool	_discardedCr;
+
+		InputBuffer(const InputBuffer &other);
+		InputBuffer	&operator=(const InputBuffer &other);
+
+		void	_compact(void);
+
+		static SlabPool	&_blocks(size_t capacity);
+		static char		*_allocate(size_t capacity);
+
+	public:
+		InputBuffer(size_t capacity);
+		~InputBuffer(void);
+
+		size_t	size(void) const;
+
+		char	*reserve(size_t &room);
+		void	commit(size_t length);
+		size_t	append(const char *data, size_t length);
+		bool	nextLine(StringView &line);
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef IO_URING_BACKEND_HPP
+#define IO_URING_BACKEND_HPP
+
+#include "EventBackend.hpp"
+#include "SendQueue.hpp"
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <stdint.h>
+
+class SharedBuffer;
+
+/*
+** Completion backend on top of the raw io_uring syscalls. Listening sockets
+** get one multishot accept, client sockets one multishot recv drawing from a
+** ring of provided buffers, and output goes out as one SENDMSG per client,
+** gathered from its SendQueue. Sockets registered without a Client (wake fd,
+** QuoteBot API) are watched with one-shot POLL_ADD, re-armed on completion.
+** Out of descriptors, accept fails before looking at the backlog, so the
+** listener then waits on POLL_ADD until a connection is actually pending.
+**
+** Every submission is tagged with the fd's registration generation, so
+** completions arriving after remove() are recognised and dropped.
+*/
+class IoUringBackend : public EventBackend
+{
+	private:
+		struct Slot
+		{
+			void		*data;
+			short		events;
+			uint32_t	generation;
+			bool		registered;
+			bool		isClient;
+			bool		recvArmed;
+			bool		sending;
+		};
+
+		struct SendOp
+		{
+			int				fd;
+			uint32_t		generation;
+			msghdr			msg;
+			iovec			iov[SENDQ_IOV_MAX];
+			SharedBuffer	*refs[SENDQ_IOV_MAX];
+			size_t			count;
+		};
+
+		int					_ringFd;
+		unsigned			_sqEntries;
+		void				*_sqRing;
+		void				*_cqRing;
+		size_t				_sqRingSize;
+		size_t				_cqRingSize;
+		io_uring_sqe		*_sqes;
+		size_t				_sqesSize;
+		unsigned			*_sqHead;
+		unsigned			*_sqTail;
+		unsigned			*_sqMask;
+		unsigned			*_sqArray;
+		unsigned			*_cqHead;
+		unsigned			*_cqTail;
+		unsigned			*_cqMask;
+		io_uring_cqe		*_cqes;
+		unsigned			_pending;
+		bool				_extArg;
+
+		io_uring_buf		*_bufRing;
+		size_t				_bufRingSize;
+		char				*_bufBase;
+		unsigned			_bufCount;
+		unsigned			_bufSize;
+		unsigned short		_bufTail;
+		std::vector<unsigned short>	_usedBuffers;
+
+		int					_listenFd;
+		std::vector<Slot>	_slots;
+		size_t				_inflightSends;
+		std::vector<SendOp *>	_retired;
+
+		bool			_setupRing(unsigned entries);
+		bool			_setupBuffers(unsigned count, unsigned size);
+		io_uring_sqe	*_getSqe(void);
+		int				_submit(unsigned waitFor, int timeout);
+		void			_recycleBuffer(unsigned short bid);
+		void			_publishBuffers(void);
+		Slot			&_slot(int fd);
+		uint64_t		_tag(int type, int fd) const;
+		void			_armAccept(int fd);
+		void			_armRecv(int fd);
+		void			_armPoll(int fd);
+		void			_cancel(uint64_t userData);
+		void			_complete(const io_uring_cqe &cqe, std::vector<IOEvent> &ready);
+		void			_completeSend(SendOp *op, int res, std::vector<IOEvent> &ready);
+		void			_releaseRetired(void);
+
+	public:
+		IoUringBackend(unsigned bufferCount, unsigned bufferSize);
+		~IoUringBackend(void);
+
+		bool		isOpen(void) const;
+		const char	*name(void) const;
+		bool		add(int fd, short events, void *data);
+		bool		modify(int fd, short events, void *data);
+		void		remove(int fd);
+		int			wait(std::vector<IOEvent> &ready, int timeout);
+
+		bool		completesIO(void) const;
+		bool		listen(int fd);
+		bool		send(int fd, SendQueue &queue);
+		size_t		pendingSends(void) const;
+};
+
+#endif
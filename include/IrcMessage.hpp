@@ -0,0 +1,40 @@
+#ifndef IRC_MESSAGE_HPP
+#define IRC_MESSAGE_HPP
+
+#include <string>
+#include "StringView.hpp"
+
+#define IRC_MAX_PARAMS 15
+
+/*
+** One protocol line, tokenized in a single pass as RFC 1459 describes it:
+**
+**     [':' prefix SPACE] command {SPACE param} [SPACE ':' trailing]
+**
+** Prefix, command and params are views into the line (so into the client's
+** input buffer) and nothing is allocated. The trailing param is stored as
+** the last param, without its ':'. Runs of spaces separate tokens, and once
+** fourteen params are read the rest of the line is the fifteenth.
+*/
+class IrcMessage
+{
+	private:
+		StringView	_prefix;
+		StringView	_command;
+		StringView	_params[IRC_MAX_PARAMS];
+		size_t		_paramCount;
+
+	public:
+		IrcMessage(void);
+		~IrcMessage(void);
+
+		const StringView	&prefix(void) const;
+		const StringView	&command(void) const;
+		size_t				paramCount(void) const;
+		StringView			param(size_t i) const;
+		std::string			arg(size_t i) const;
+
+		bool	parse(const StringView &line);
+};
+
+#endif
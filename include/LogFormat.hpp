@@ -0,0 +1,51 @@
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <string>
+#include <cstddef>
+
+#define LOG_TEXT_MAX		496		/* message or encoded arguments, truncated past this */
+
+/* Binary log file: LOG_FILE_MAGIC, then records tagged with one of these */
+#define LOG_FILE_MAGIC		"IRCBLOG1"
+#define LOG_FILE_MAGIC_SIZE	8
+#define LOG_RECORD_FORMAT	'D'		/* u32 id, u16 length, format string */
+#define LOG_RECORD_EVENT	'E'		/* u8 level, u32 format id, i64 time, u16 length, arguments */
+#define LOG_RECORD_TEXT		'T'		/* u8 level, i64 time, u16 length, text */
+
+/* Encoded argument tags */
+#define LOG_ARG_INT			'i'		/* i64 */
+#define LOG_ARG_UINT		'u'		/* u64 */
+#define LOG_ARG_STRING		's'		/* u16 length, bytes */
+
+/*
+** The raw arguments of a deferred log statement, tagged by type. Nothing is
+** formatted here: the format string travels as a pointer and renderLog()
+** puts the two together later, on the log writer thread or in the offline
+** decoder. Arguments that no longer fit are dropped.
+*/
+class LogArgs
+{
+	private:
+		char	_data[LOG_TEXT_MAX];
+		size_t	_size;
+
+		void	_put(char tag, const void *value, size_t length);
+
+	public:
+		LogArgs(void);
+
+		const char	*data(void) const;
+		size_t		size(void) const;
+
+		LogArgs	&operator<<(int value);
+		LogArgs	&operator<<(long value);
+		LogArgs	&operator<<(unsigned int value);
+		LogArgs	&operator<<(unsigned long value);
+		LogArgs	&operator<<(const char *text);
+		LogArgs	&operator<<(const std::string &text);
+};
+
+size_t	renderLog(const char *format, const char *args, size_t length, char *out, size_t room);
+
+#endif
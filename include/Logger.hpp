@@ -0,0 +1,168 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <string>
+#include <map>
+#include <ctime>
+#include <pthread.h>
+#include "LogFormat.hpp"
+
+#define LOG_STAMP_SIZE		32
+#define LOG_LINE_MAX		(LOG_TEXT_MAX + 64)
+#define LOG_RECORD_MAX		(2 * LOG_TEXT_MAX + 32)	/* format definition and event */
+#define LOG_OUTPUT_SIZE		65536	/* writer's batch buffer */
+
+enum LogLevel
+{
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR
+};
+
+/*
+** Deferred-format logging: LOGF_INFO("%s joined %s", nick, channel) stores
+** the format string's address and the raw arguments, nothing else. Levels
+** below LOG_LEVEL_MIN (make LOG_LEVEL=n) compile to nothing, arguments
+** included. Expressions, so `return LOGF_WARNING(...)` works like warning().
+*/
+#ifndef LOG_LEVEL_MIN
+# define LOG_LEVEL_MIN	LOG_INFO
+#endif
+
+#if LOG_LEVEL_MIN <= 0
+# define LOGF_INFO(...)		Logger::event(LOG_INFO, __VA_ARGS__)
+#else
+# define LOGF_INFO(...)		((void)0)
+#endif
+#if LOG_LEVEL_MIN <= 1
+# define LOGF_WARNING(...)	Logger::event(LOG_WARNING, __VA_ARGS__)
+#else
+# define LOGF_WARNING(...)	((void)0)
+#endif
+#if LOG_LEVEL_MIN <= 2
+# define LOGF_ERROR(...)	Logger::event(LOG_ERROR, __VA_ARGS__)
+#else
+# define LOGF_ERROR(...)	((void)0)
+#endif
+
+/*
+** info(), warning() and error() hand their message to a ring of fixed-size
+** records and return; a background thread formats the timestamp and writes
+** the records out in batches. A slow reader on stdout stalls that thread,
+** not the event loops.
+**
+** The ring is single-producer/single-consumer and lock-free on the writer's
+** side. Producers take a short mutex between themselves, uncontended unless
+** several event loops log at once. When the ring is full the record is
+** dropped (and counted) or, with the block policy, the caller sleeps until
+** the writer makes room; every other thread that logs meanwhile waits too.
+** The idle writer sleeps until a record arrives. Either side only takes the
+** wake-up mutex when the other one is asleep.
+**
+** Timestamps come from a clock the event loops refresh once per iteration
+** with tick(), so logging never calls time() or localtime() on the hot path.
+** Before start() and after stop() messages are written synchronously.
+**
+** Deferred records are rendered to text by the writer thread, or, with a
+** binary log file, written out as they are: each format string once, then
+** its id, the time and the raw arguments per event. tools/LogDecoder turns
+** the file back into text.
+*/
+class Logger
+{
+	private:
+		struct Record
+		{
+			std::time_t	time;
+			LogLevel	level;
+			const char	*format;	/* NULL: text holds the message itself */
+			size_t		length;
+			char		text[LOG_TEXT_MAX];
+		};
+
+		typedef std::map<const char *, unsigned int>	formats_t;
+
+		static Record			*_ring;
+		static size_t			_mask;
+		static size_t			_head;
+		static size_t			_tail;
+		static bool				_block;
+		static bool				_running;
+		static size_t			_dropped;
+		static std::time_t		_now;
+		static int				_binaryFd;
+		static pthread_t		_writer;
+		static pthread_mutex_t	_produce;
+		static pthread_mutex_t	_wake;
+		static pthread_cond_t	_notEmpty;
+		static pthread_cond_t	_notFull;
+		static bool				_writerIdle;
+		static bool				_producerBlocked;
+
+		Logger(void);
+
+		static void		*_writerMain(void *unused);
+		static void		_signal(bool &waiting, pthread_cond_t &cond);
+		static void		_waitWriter(void);
+		static void		_waitRoom(size_t head);
+		static void		_stamp(std::time_t time, char *stamp);
+		static size_t	_format(char *out, const Record &record, const char *stamp);
+		static size_t	_encode(char *out, const Record &record, formats_t &formats);
+		static void		_fill(Record &record, std::time_t time, LogLevel level,
+							const char *format, const char *data, size_t length);
+		static void		_write(int fd, const char *data, size_t length);
+		static void		_writeNow(LogLevel level, const char *format, const char *data, size_t length);
+		static void		_push(LogLevel level, const char *format, const char *data, size_t length);
+
+	public:
+		static void	start(size_t ringSize, bool blockWhenFull, const std::string &binaryPath);
+		static void	stop(void);
+		static void	tick(void);
+		static void	log(LogLevel level, const std::string &message);
+		static void	log(LogLevel level, const char *format, const LogArgs &args);
+
+		static void	event(LogLevel level, const char *format);
+		template <typename A>
+		static void	event(LogLevel level, const char *format, const A &a);
+		template <typename A, typename B>
+		static void	event(LogLevel level, const char *format, const A &a, const B &b);
+		template <typename A, typename B, typename C>
+		static void	event(LogLevel level, const char *format, const A &a, const B &b, const C &c);
+		template <typename A, typename B, typename C, typename D>
+		static void	event(LogLevel level, const char *format, const A &a, const B &b, const C &c, const D &d);
+};
+
+inline void	Logger::event(LogLevel level, const char *format)
+{
+	log(level, format, LogArgs());
+}
+
+template <typename A>
+void	Logger::event(LogLevel level, const char *format, const A &a)
+{
+	LogArgs	args;
+	log(level, format, args << a);
+}
+
+template <typename A, typename B>
+void	Logger::event(LogLevel level, const char *format, const A &a, const B &b)
+{
+	LogArgs	args;
+	log(level, format, args << a << b);
+}
+
+template <typename A, typename B, typename C>
+void	Logger::event(LogLevel level, const char *format, const A &a, const B &b, const C &c)
+{
+	LogArgs	args;
+	log(level, format, args << a << b << c);
+}
+
+template <typename A, typename B, typename C, typename D>
+void	Logger::event(LogLevel level, const char *format, const A &a, const B &b, const C &c, const D &d)
+{
+	LogArgs	args;
+	log(level, format, args << a << b << c << d);
+}
+
+#endif
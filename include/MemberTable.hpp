@@ -0,0 +1,63 @@
+#ifndef MEMBER_TABLE_HPP
+#define MEMBER_TABLE_HPP
+
+#include <vector>
+#include <cstddef>
+
+class Client;
+class Channel;
+class SlabPool;
+
+/* Per-member mode bits */
+#define MEMBER_OP		0x1
+#define MEMBER_VOICE	0x2
+
+/*
+** One client's presence in one channel. It sits in the channel's MemberTable
+** and in the client's own channel list, and remembers its position in both,
+** so either side drops it in O(1).
+*/
+struct Membership
+{
+	Client	*client;
+	Channel	*channel;
+	int		flags;
+	size_t	memberPos;
+	size_t	channelPos;
+
+	static void		*operator new(size_t size);
+	static void		operator delete(void *block);
+	static SlabPool	&pool(void);
+};
+
+/*
+** The members of a channel, densely packed for fan-out, with an
+** open-addressing index by Client* beside them: lookup, insertion and removal
+** are O(1) whatever the channel size. Removal moves the last member into the
+** freed position, and the index drops entries by shifting the following ones
+** back, so it never fills up with tombstones.
+*/
+class MemberTable
+{
+	private:
+		std::vector<Membership *>	_members;
+		std::vector<Membership *>	_index;
+
+		size_t	_home(const Client *client) const;
+		size_t	_probe(const Client *client) const;
+		void	_grow(void);
+
+	public:
+		MemberTable(void);
+		~MemberTable(void);
+
+		size_t		size(void) const;
+		bool		empty(void) const;
+		Membership	*operator[](size_t i) const;
+
+		Membership	*find(const Client *client) const;
+		bool		insert(Membership *member);
+		void		erase(Membership *member);
+};
+
+#endif
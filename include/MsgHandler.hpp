@@ -2,7 +2,11 @@
 #define MSGHANDLER_HPP
 #include "irc.hpp"
 
+/* readInput() result when the input buffer had no room, so nothing was read */
+#define READ_SKIPPED -2
+
 class ChannelManager;
+struct CommandSpec;
 
 class MsgHandler
 {
@@ -10,28 +14,37 @@ class MsgHandler
 		Server& _server;
 		ChannelManager& _manager;
 
+		void _dispatch(const CommandSpec *spec, const IrcMessage &msg, Client &client);
+		void _processLines(Client &client, bool limited);
+		static std::string _percentiles(const Histogram &histogram);
+
     public:
 		MsgHandler(Server& server, ChannelManager& _manager);
 		~MsgHandler();
 
-		void respond(std::string &msg, Client &client);
-		void receiveMessage(Client &client);
-		void handleNICK(std::vector<std::string> &msgData, Client &client);
-		void handleMODE(std::vector<std::string> &msgData, Client &client);
-		void handlePART(std::vector<std::string> &msgData, Client &client);
-		void handlePASS(std::vector<std::string> &msgData, Client &client);
-		void handleOPER(std::vector<std::string> &msgData, Client &client);
-		void handleJOIN(std::vector<std::string> &msgData, Client &client);
-		void handleINVITE(std::vector<std::string> &msgData, Client &client);
-		void handleUSER(std::string &msgData, Client &client);
-		void handlePRIVMSG(std::string &msg, Client &client);
-
-		void handleKICK(std::string &msg, Client &client);
-		void handleTOPIC(std::string &msg, Client &client);
-		void handleQUIT(std::string &msg, Client &client);
-		void handleKILL(std::string &msg, Client &client);
+		void respond(const CommandSpec *spec, const IrcMessage &msg, Client &client);
+		ssize_t readInput(Client &client);
+		void appendInput(Client &client, const char *data, size_t length);
+		void processInput(Client &client);
+		void handleNICK(const IrcMessage &msg, Client &client);
+		void handleMODE(const IrcMessage &msg, Client &client);
+		void handlePART(const IrcMessage &msg, Client &client);
+		void handlePASS(const IrcMessage &msg, Client &client);
+		void handleOPER(const IrcMessage &msg, Client &client);
+		void handleJOIN(const IrcMessage &msg, Client &client);
+		void handleINVITE(const IrcMessage &msg, Client &client);
+		void handleUSER(const IrcMessage &msg, Client &client);
+		void handlePRIVMSG(const IrcMessage &msg, Client &client);
+
+		void handleKICK(const IrcMessage &msg, Client &client);
+		void handleTOPIC(const IrcMessage &msg, Client &client);
+		void handleQUIT(const IrcMessage &msg, Client &client);
+		void handleKILL(const IrcMessage &msg, Client &client);
 		void handleQuote(const std::string &channelTarget, Client &client);
-		void handleDIE(Client &client);
+		void handleDIE(const IrcMessage &msg, Client &client);
+		void handlePING(const IrcMessage &msg, Client &client);
+		void handleSTATS(const IrcMessage &msg, Client &client);
+		void handleLUSERS(const IrcMessage &msg, Client &client);
 		void handleSENDFILE(std::string &msg, Client &client);
 		void handleGETFILE(std::string &msg, Client &client);
 
@@ -0,0 +1,31 @@
+#ifndef POLL_BACKEND_HPP
+#define POLL_BACKEND_HPP
+
+#include "EventBackend.hpp"
+
+/*
+** The pollfd array stays dense for poll(2); _index maps an fd to its
+** position so updates are O(1), and removal moves the last entry into the
+** freed position.
+*/
+class PollBackend : public EventBackend
+{
+	private:
+		std::vector<pollfd>	_pollfds;
+		std::vector<void *>	_data;
+		std::vector<int>	_index;
+
+		int		_indexOf(int fd) const;
+
+	public:
+		PollBackend(void);
+		~PollBackend(void);
+
+		const char	*name(void) const;
+		bool		add(int fd, short events, void *data);
+		bool		modify(int fd, short events, void *data);
+		void		remove(int fd);
+		int			wait(std::vector<IOEvent> &ready, int timeout);
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef REPLY_HPP
+#define REPLY_HPP
+
+#include <string>
+#include <cstddef>
+#include "StringView.hpp"
+
+#define REPLY_MAX_LENGTH 512
+
+class Client;
+
+/*
+** One protocol line, formatted in place in a fixed buffer on the stack.
+** Numerics start from the ":<server> " prefix built once at startup, the
+** other pieces are appended with <<, and the line always ends in CRLF;
+** whatever goes past the 512 bytes RFC 1459 allows is cut. No heap
+** allocation happens until sendMSG() copies the line into the client's
+** SendQueue, or a broadcast into the one SharedBuffer its members share.
+*/
+class Reply
+{
+	private:
+		static char		_serverPrefix[64];
+		static size_t	_serverPrefixLength;
+
+		char	_line[REPLY_MAX_LENGTH];
+		size_t	_length;
+
+		void	_append(const char *text, size_t length);
+
+	public:
+		static void		setServerName(const std::string &name);
+
+		Reply(void);
+		explicit Reply(const char *command);
+		Reply(const char *numeric, const Client &target);
+		explicit Reply(const Client &source);
+
+		Reply	&operator<<(const char *text);
+		Reply	&operator<<(const std::string &text);
+		Reply	&operator<<(const StringView &text);
+		Reply	&operator<<(char c);
+		Reply	&operator<<(int value);
+		Reply	&operator<<(size_t value);
+
+		const char	*data(void) const;
+		size_t		size(void) const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SEND_QUEUE_HPP
+#define SEND_QUEUE_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "SharedBuffer.hpp"
+
+#define SENDQ_IOV_MAX 64
+#define SENDQ_CHUNK_SIZE 4096
+
+/*
+** Output bytes a client has not accepted yet, as references to shared
+** buffers (see SharedBuffer). Replies are appended whole and
+** written out as the socket allows, as many chunks per sendmsg() as fit in
+** one iovec array; the part of the front chunk that already went out is
+** tracked by _offset, so a short write never loses or repeats bytes of the
+** protocol stream.
+**
+** Replies for this client alone are copied into _tail, a chunk of
+** SENDQ_CHUNK_SIZE bytes the queue still owns, so a run of replies shares
+** one allocation. A broadcast buffer pushed behind it closes the tail.
+**
+** Every queue also counts its bytes in a server-wide total, kept under the
+** server state lock like the queues themselves. send() is the exception: the
+** owning loop calls it without the lock on a queue no other thread touches,
+** so it only takes the sent bytes off the front. Dropping the references
+** and the total waits for settle(), under the lock. size() may be read from
+** another thread meanwhile.
+*/
+class SendQueue
+{
+	private:
+		std::deque<SharedBuffer *>	_chunks;
+		SharedBuffer			*_tail;
+		size_t					_offset;
+		size_t					_bytes;
+		size_t					_unsettled;
+		std::vector<SharedBuffer *>	_spent;
+
+		void	_drop(size_t sent);
+
+		static size_t			_queued;
+
+	public:
+		static size_t	totalQueued(void);
+
+		SendQueue(void);
+		~SendQueue(void);
+
+		bool	empty(void) const;
+		size_t	size(void) const;
+
+		void	push(const std::string &data);
+		void	push(const char *data, size_t length);
+		void	push(SharedBuffer *buffer);
+		void	splice(SendQueue &from);
+		ssize_t	send(int fd);
+		ssize_t	flush(int fd);
+		void	settle(void);
+		size_t	gather(iovec *iov, SharedBuffer **refs, size_t max) const;
+		void	consume(size_t sent);
+		void	clear(void);
+};
+
+#endif
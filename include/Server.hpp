@@ -2,28 +2,54 @@
 #define SERVER_HPP
 #include "irc.hpp"
 #include "QuoteBot.hpp"
+#include "EventBackend.hpp"
+#include "EventLoop.hpp"
+#include "ClientTable.hpp"
+#include "HashMap.hpp"
 
 class	Client;
 class	QuoteBot;
+class	ChannelManager;
+class	MsgHandler;
+struct	ServerStats;
 
-typedef std::pair<int, Client *>	client_pair_t;
-typedef std::map<int, Client *>		clients_t;
+typedef ClientTable		clients_t;
 
 class Server
 {
 	protected:
 
 	private:
-		std::vector<pollfd>		_sockets;
+		std::vector<EventLoop *>	_loops;
+		pthread_mutex_t			_stateLock;
+		int						_reserveFd;
+		size_t					_recvBufferSize;
+		size_t					_floodLines;
+		size_t					_floodLineBurst;
+		size_t					_floodBytes;
+		size_t					_floodByteBurst;
+		size_t					_sendqMax;
+		size_t					_sendqMaxOper;
+		ChannelManager*			_manager;
+		MsgHandler*				_msgHandler;
 		clients_t				_clients;
+		HashMap<Client *>		_nicknames;
+		HashMap<std::vector<Client *> >	_usernames;
+		HashMap<int>			_nickSuffixes;
 		std::string				_password;
 		unsigned int			_port;
-		static bool				_running;
+		static volatile sig_atomic_t	_running;
+		static volatile sig_atomic_t	_interrupted;
 		QuoteBot*				_quoteBot;
 
 		std::map<std::string, std::string>	_opers;
+		std::map<std::string, std::string>	_config;
 
 		pollfd	_makePollfd(int fd, short int events, short int revents);
+		void	_notifyShutdown(void);
+		void	_unindexClient(Client &client);
+		void	_releaseNickname(Client &client);
+		void	_unindexUsername(Client &client);
 
 	public:
 		/* construcotrs & destructors */
@@ -35,26 +61,41 @@ class Server
 		std::string							getPassword(void);
 		unsigned int						getPort(void);
 		clients_t&							getClients(void);
-		Client*								getClientByUser(std::string& user) const;
-		Client*								getClientByNick(std::string& nick) const;
+		Client*								getClientByUser(const std::string& user) const;
+		Client*								getClientByNick(const std::string& nick) const;
 		QuoteBot*							getQuoteBot(void);
+		ChannelManager&						getManager(void);
+		MsgHandler&							getMsgHandler(void);
+		bool								isRunning(void) const;
+		std::string							getConfig(const std::string &key, const std::string &fallback) const;
+		size_t								getConfigSize(const std::string &key, size_t fallback) const;
 		
 		/* member functions*/
 		void 			run(void);
 		void 			parseOpersConfigFile(const char *file);
-		void 			handleNewConnectionRequest();
+		void 			parseServerConfigFile(const char *file);
+		void 			handleNewConnectionRequest(EventLoop &loop);
+		void			admitClient(int fd, EventLoop &loop);
+		void			handleAcceptError(int err, EventLoop &loop);
 		void			validatePassword(std::string &password, Client &client);
 		void			validateIRCOp(std::string &nickname, std::string &password, Client &client);
-		void 			addclient(pollfd &clientSocket);
+		std::string		uniqueNickname(const std::string &requested);
+		void			renameClient(Client &client, std::string &nickname);
+		void			setClientUsername(Client &client, std::string &username);
+		Client*			addclient(pollfd &clientSocket, EventLoop &loop);
 		void 			disconnectClient(Client *client);
+		void 			disconnectClient(Client *client, const std::string &reason);
 		void			shutdown();
+		void			lock(void);
+		void			unlock(void);
 		void			addApiSocket(pollfd &api_pfd);
 		void			removeApiSocket(int fd);
 		void			setBot();
-		bool			handleApiEvent(pollfd fd);
+		void			handleApiEvent(const IOEvent &event);
 
 		/* static members */
 		static Server*  instance;
+		static ServerStats	stats;
 		static void 	SIGINTHandler(int signum);
 	};
 
@@ -0,0 +1,47 @@
+#ifndef SHARED_BUFFER_HPP
+#define SHARED_BUFFER_HPP
+
+#include <string>
+#include <cstddef>
+
+/*
+** A reference-counted run of output bytes. A broadcast serializes its line
+** once into one of these and every recipient's SendQueue holds a reference
+** to it, so fan-out copies no bytes and allocates nothing per member. Header
+** and bytes come from a single allocation.
+**
+** A buffer created with spare capacity can be appended to by its owner;
+** bytes already in it never change, so an in-flight send of them is safe.
+**
+** The count is not atomic: buffers are only retained and released with the
+** server state lock held.
+*/
+class SharedBuffer
+{
+	private:
+		size_t	_refs;
+		size_t	_size;
+		size_t	_capacity;
+
+		SharedBuffer(size_t capacity);
+		~SharedBuffer(void);
+		SharedBuffer(const SharedBuffer &other);
+		SharedBuffer	&operator=(const SharedBuffer &other);
+
+		char	*_bytes(void);
+
+	public:
+		static SharedBuffer	*create(const char *data, size_t length);
+		static SharedBuffer	*create(size_t capacity);
+
+		const char	*data(void) const;
+		size_t		size(void) const;
+		size_t		room(void) const;
+
+		void		append(const char *data, size_t length);
+
+		void		retain(void);
+		void		release(void);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SLAB_POOL_HPP
+#define SLAB_POOL_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/*
+** Fixed-size blocks for one type of object, carved out of slabs of
+** `blocksPerSlab` blocks at a time. Freed blocks go on a free list and are
+** handed out again before any new slab is taken from the heap; slabs are only
+** given back when the pool is destroyed, so connection and channel churn
+** reuses the same memory instead of fragmenting the heap.
+**
+** Not synchronized: objects are created and destroyed with the server state
+** lock held. Every pool registers itself so their counters can be reported.
+*/
+class SlabPool
+{
+	private:
+		struct FreeBlock
+		{
+			FreeBlock	*next;
+		};
+
+		const char			*_name;
+		size_t				_blockSize;
+		size_t				_blocksPerSlab;
+		std::vector<char *>	_slabs;
+		FreeBlock			*_free;
+		size_t				_live;
+		size_t				_available;
+
+		SlabPool(const SlabPool &other);
+		SlabPool	&operator=(const SlabPool &other);
+
+		void	_addSlab(void);
+
+		static std::vector<SlabPool *>	&_registry(void);
+
+	public:
+		SlabPool(const char *name, size_t blockSize, size_t blocksPerSlab);
+		~SlabPool(void);
+
+		const char	*name(void) const;
+		size_t		blockSize(void) const;
+		size_t		live(void) const;
+		size_t		available(void) const;
+
+		void		*allocate(void);
+		void		release(void *block);
+		std::string	report(void) const;
+
+		static const std::vector<SlabPool *>	&pools(void);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef STRING_VIEW_HPP
+#define STRING_VIEW_HPP
+
+#include <string>
+#include <cstddef>
+
+/*
+** A borrowed run of bytes: pointer and length into a buffer owned by someone
+** else, valid only as long as that buffer is left untouched.
+*/
+struct StringView
+{
+	const char	*data;
+	size_t		size;
+
+	StringView(void) : data(NULL), size(0) {}
+	StringView(const char *bytes, size_t length) : data(bytes), size(length) {}
+
+	bool		empty(void) const { return (size == 0); }
+	std::string	str(void) const { return (std::string(data, size)); }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TOKEN_BUCKET_HPP
+#define TOKEN_BUCKET_HPP
+
+#include <stdint.h>
+
+/*
+** Refills at `rate` tokens a second up to `burst`. Spending may take the
+** bucket below zero: the debt is paid back before anything else is allowed,
+** so one long line is never refused, only followed by a longer pause. A
+** rate of 0 means no limit.
+**
+** Not synchronized: used by the shard that owns the client.
+*/
+class TokenBucket
+{
+	private:
+		double		_tokens;
+		double		_rate;
+		double		_burst;
+		uint64_t	_refilled;
+
+	public:
+		TokenBucket(void);
+
+		void		setLimit(double rate, double burst, uint64_t now);
+		bool		available(uint64_t now);
+		void		spend(double cost);
+		uint64_t	refillDelay(void) const;
+};
+
+#endif
@@ -5,6 +5,8 @@
 
 /* Standard Library */
 #include <cstring>
+#include <cerrno>
+#include <unistd.h>
 
 /* String & Stream */
 #include <string>
@@ -36,9 +38,23 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 
+#include "Logger.hpp"
+#include "SlabPool.hpp"
+#include "Histogram.hpp"
+#include "TokenBucket.hpp"
+#include "SendQueue.hpp"
+#include "StringView.hpp"
+#include "InputBuffer.hpp"
+#include "IrcMessage.hpp"
+#include "Reply.hpp"
+#include "ClientTable.hpp"
+#include "MemberTable.hpp"
+#include "HashMap.hpp"
 #include "Server.hpp"
+#include "EventLoop.hpp"
 #include "Client.hpp"
 #include "Channel.hpp"
 #include "MsgHandler.hpp"
@@ -47,6 +63,7 @@
 /* Macros */
 #define MIN_PORT 1024
 #define MAX_PORT 65535
+#define MAX_LINE_LENGTH 512
 #define SERVER_NAME std::string("42irc.local")
 
 /* Error messages */
@@ -55,55 +72,64 @@
 #define ERR_PORT_NUMERIC "Port number must be numeric (1024 - 65535)"
 #define ERR_INVALID_PASSWORD "Invalid password"
 #define ERR_PASSWORD_FORMAT "Password must be between 4-6 characters long"
-#define ERR_NOSUCHNICK(client, nick) std::string(":") + SERVER_NAME + " 401 " + client.nickname() + " " + nick + " :No such nick\r\n"
-#define ERR_NOSUCHCHANNEL(client, channelName) std::string(":") + SERVER_NAME + " 403 " + client.nickname() + " " + channelName + " :No such channel\r\n"
-#define ERR_NORECIPIENT(client, command) std::string(":") + SERVER_NAME + " 411 " + client.nickname() + " :No recipient given (" + command + ")\r\n"   
-#define ERR_MSGTOOLONG(client, message) std::string(":") + SERVER_NAME + " 414 " + client.nickname() + " :Message is too long\r\n"
-#define ERR_NONICKNAMEGIVEN(client) std::string(":") + SERVER_NAME + " 431 " + client.nickname() + " :No nickname given\r\n"
-#define ERR_NICKNAMEINUSE(client, newNickname) std::string(":") + SERVER_NAME + " 433 " + client.nickname() + " " + newNickname + " :Nickname already in use\r\n"
-#define ERR_NOTONCHANNEL(client, channelName) std::string(":") + SERVER_NAME + " 442 " + client.nickname() + " " + channelName + " : You're not in that channel\r\n"
-#define ERR_NOTREGISTERED(client) std::string(":") + SERVER_NAME + " 451 " + client.nickname() + " :You have not registered\r\n"
-#define ERR_NEEDMOREPARAMS(client, command) std::string(":") + SERVER_NAME + " 461 " + client.nickname() + " " + command + " :Not enough parameters\r\n"
-#define ERR_PASSWDMISMATCH(client) std::string(":") + SERVER_NAME + " 464 " + client.nickname() + " :Password incorrect\r\n"
-#define ERR_CHANNELISFULL(client, channelName) std::string(":") + SERVER_NAME + " 471 " + client.nickname() + " " + channelName + " :Cannot join channel (+l)\r\n"
-#define ERR_UNKNOWNMODE(client, c) std::string(":") + SERVER_NAME + " 472 " + client.nickname() + " " + c + " : is unknown mode char to me\r\n"
-#define ERR_INVITEONLYCHAN(client, channelName) std::string(":") + SERVER_NAME + " 473 " + client.nickname() + " " + channelName + " :Cannot join channel (+i)\r\n"
-#define ERR_BADCHANNELKEY(client, channelName) std::string(":") + SERVER_NAME + " 475 " + client.nickname() + " " + channelName + " :Cannot join channel (+k)\r\n"
-#define ERR_QUOTEBOTCONNECTING(client) std::string(":") + SERVER_NAME + client.nickname() + " QuoteBot is busy right now. Try again later\r\n"
-#define ERR_BADCHANMASK(client, channelName) std::string(":") + SERVER_NAME + " 476 " + client.nickname() + " " + channelName + " :Bad Channel Mask\r\n"
-#define ERR_NOPRIVILAGES(client) std::string(":") + SERVER_NAME + " 481 " + client.nickname() + ": :Permission Denied- You're not an IRC operator\r\n"
-#define ERR_CHANOPPROVSNEEDED(client, channelName) std::string(":") + SERVER_NAME + " 482 " + client.nickname() + " " + channelName + " : You're not a channel operator\r\n"
-#define ERR_NOOPERHOST(client) std::string(":") + SERVER_NAME + " 491 " + client.nickname() + " :No O-lines for your host\r\n"
-
-#define RPL_WELCOME(client) std::string(":") + SERVER_NAME + " 001 " + client.nickname() + " :Welcome to the IRC Network, " + client.nickname() + "!" + client.username() + "@" + client.hostname() + "\r\n"
-#define RPL_YOURHOST(client) std::string(":") + SERVER_NAME + " 002 " + client.nickname() + " :Your host is " + SERVER_NAME + ", running version 1.0\r\n"
-#define RPL_CREATED(client) std::string(":") + SERVER_NAME + " 003 " + client.nickname() + " :This server was created, 2025-03-31\r\n"
-#define RPL_MYINFO(client) std::string(":") + SERVER_NAME + " 004 " + client.nickname() + " " + SERVER_NAME + " 1.0 o itkol\r\n"
-#define RPL_REGISTERED(client) std::string(":") + SERVER_NAME + client.nickname() + " You're registered now\r\n"
-#define RPL_NOTOPIC(client, channelName) std::string(":") + SERVER_NAME + " 331 " + client.nickname() + " " + channelName + " :No topic is set\r\n"
-#define RPL_TOPIC(client, channelName, topic) std::string(":") + SERVER_NAME + " 332 " + client.nickname() + " " + channelName + " :" + topic + "\r\n"
-#define RPL_TOPICWHOTIME(client, channelName, nick, setAt) std::string(":") + SERVER_NAME + " 333 " + client.nickname() + " " + channelName + " " + nick + " " + setAt + "\r\n"
-#define RPL_INVITING(client, nickname, channel) std::string(":") + SERVER_NAME + " 341 " + client.nickname() + " " + nickname + " " + channel + "\r\n"
-#define RPL_YOUROPER(client) std::string(":") + SERVER_NAME + " 381 " + client.nickname() + " :You are now an IRC operator\r\n"
-#define RPL_NOTINCHANNEL(client, channel) std::string(":") + SERVER_NAME + " 442 " + client.nickname() + " " + channel + " :You're not on that channel\r\n"
-#define KILL(killer, victim, channel, reason) std::string(":") + killer.nickname() + " KILL " + victim.nickname() + " :" + reason + " (killed by " + killer.nickname() + ")\r\n"
-#define QUITKILLEDBY(client, killer, reason) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " QUIT :Killed by " + killer.nickname() + " (" + reason + ")\r\n"
-#define QUIT(client, message) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " QUIT :" + message + "\r\n"
-#define DIE(client) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " DIE: server terminated\r\n"
-#define STD_PREFIX(client) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname()
-#define PONG std::string("PONG ") + SERVER_NAME + "\r\n"
-#define KICK(kicker, channel, client, reason) std::string(":") + kicker.nickname() + "!" + kicker.username() + "@" + kicker.hostname() + " KICK " + channel + " " + client + " :" + reason + "\r\n"
-#define INVITE(client, nickname, channel) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " INVITE " + nickname + " :" + channel + "\r\n"
-#define JOIN(client, nickname, channel) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " JOIN " + " :" + channel + "\r\n"
-#define PART(client, channelName) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " PART " + channelName + "\r\n"
-#define PRIVMSG(client, channelName, message) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " PRIVMSG " + channelName + " :" + message + "\r\n"
-#define ADDOP(client, recipient, channelName) std::string(":") + client.nickname() + "!" + client.username() + "@" + client.hostname() + " PRIVMSG " + channelName + " :" + "Client " + recipient + " added as " + _channelName + " channel Operator by " + client.nickname() + "\r\n"
-#define NOTICE(client, message) std::string(":") + SERVER_NAME + " " + client + " NOTICE : " + message + "\r\n"
-#define QUOTEGREETING(channelName) std::string(":") + "QuoteBotAPI!QuoteBot@api.forismatic.com PRIVMSG " + channelName + " :QuoteBot is here to help you! Just type !quote\r\n"
+#define ERR_NOSUCHNICK(client, nick) Reply("401", client) << ' ' << nick << " :No such nick"
+#define ERR_NOSUCHCHANNEL(client, channelName) Reply("403", client) << ' ' << channelName << " :No such channel"
+#define ERR_NORECIPIENT(client, command) Reply("411", client) << " :No recipient given (" << command << ')'
+#define ERR_MSGTOOLONG(client, message) Reply("414", client) << " :Message is too long"
+#define ERR_NONICKNAMEGIVEN(client) Reply("431", client) << " :No nickname given"
+#define ERR_NICKNAMEINUSE(client, newNickname) Reply("433", client) << ' ' << newNickname << " :Nickname already in use"
+#define ERR_USERNOTINCHANNEL(client, nick, channelName) Reply("441", client) << ' ' << nick << ' ' << channelName << " :They aren't on that channel"
+#define ERR_NOTONCHANNEL(client, channelName) Reply("442", client) << ' ' << channelName << " : You're not in that channel"
+#define ERR_NOTREGISTERED(client) Reply("451", client) << " :You have not registered"
+#define ERR_NEEDMOREPARAMS(client, command) Reply("461", client) << ' ' << command << " :Not enough parameters"
+#define ERR_PASSWDMISMATCH(client) Reply("464", client) << " :Password incorrect"
+#define ERR_CHANNELISFULL(client, channelName) Reply("471", client) << ' ' << channelName << " :Cannot join channel (+l)"
+#define ERR_UNKNOWNMODE(client, c) Reply("472", client) << ' ' << c << " : is unknown mode char to me"
+#define ERR_INVITEONLYCHAN(client, channelName) Reply("473", client) << ' ' << channelName << " :Cannot join channel (+i)"
+#define ERR_BADCHANNELKEY(client, channelName) Reply("475", client) << ' ' << channelName << " :Cannot join channel (+k)"
+#define ERR_QUOTEBOTCONNECTING(client) NOTICE(client.nickname(), "QuoteBot is busy right now. Try again later")
+#define ERR_BADCHANMASK(client, channelName) Reply("476", client) << ' ' << channelName << " :Bad Channel Mask"
+#define ERR_NOPRIVILAGES(client) Reply("481", client) << " :Permission Denied- You're not an IRC operator"
+#define ERR_CHANOPPROVSNEEDED(client, channelName) Reply("482", client) << ' ' << channelName << " : You're not a channel operator"
+#define ERR_NOOPERHOST(client) Reply("491", client) << " :No O-lines for your host"
+
+#define RPL_WELCOME(client) Reply("001", client) << " :Welcome to the IRC Network, " << client.nickname() << '!' << client.username() << '@' << client.hostname()
+#define RPL_YOURHOST(client) Reply("002", client) << " :Your host is " << SERVER_NAME << ", running version 1.0"
+#define RPL_CREATED(client) Reply("003", client) << " :This server was created, 2025-03-31"
+#define RPL_MYINFO(client) Reply("004", client) << ' ' << SERVER_NAME << " 1.0 o itkol"
+#define RPL_REGISTERED(client) NOTICE(client.nickname(), "You're registered now")
+#define RPL_STATSCOMMANDS(client, command, count) Reply("212", client) << ' ' << command << ' ' << count
+#define RPL_ENDOFSTATS(client, letter) Reply("219", client) << ' ' << letter << " :End of STATS report"
+#define RPL_STATSUPTIME(client, uptime) Reply("242", client) << " :Server Up " << uptime
+#define RPL_STATSTEXT(client, letter, text) Reply("249", client) << ' ' << letter << " :" << text
+#define RPL_LUSERCLIENT(client, users) Reply("251", client) << " :There are " << users << " users and 0 services on 1 servers"
+#define RPL_LUSEROP(client, opers) Reply("252", client) << ' ' << opers << " :operator(s) online"
+#define RPL_LUSERUNKNOWN(client, unknown) Reply("253", client) << ' ' << unknown << " :unknown connection(s)"
+#define RPL_LUSERCHANNELS(client, channels) Reply("254", client) << ' ' << channels << " :channels formed"
+#define RPL_LUSERME(client, clients) Reply("255", client) << " :I have " << clients << " clients and 0 servers"
+#define RPL_NOTOPIC(client, channelName) Reply("331", client) << ' ' << channelName << " :No topic is set"
+#define RPL_TOPIC(client, channelName, topic) Reply("332", client) << ' ' << channelName << " :" << topic
+#define RPL_TOPICWHOTIME(client, channelName, nick, setAt) Reply("333", client) << ' ' << channelName << ' ' << nick << ' ' << setAt
+#define RPL_INVITING(client, nickname, channel) Reply("341", client) << ' ' << nickname << ' ' << channel
+#define RPL_YOUROPER(client) Reply("381", client) << " :You are now an IRC operator"
+#define RPL_NOTINCHANNEL(client, channel) Reply("442", client) << ' ' << channel << " :You're not on that channel"
+#define KILL(killer, victim, channel, reason) Reply() << ':' << killer.nickname() << " KILL " << victim.nickname() << " :" << reason << " (killed by " << killer.nickname() << ')'
+#define QUITKILLEDBY(client, killer, reason) Reply(client) << " QUIT :Killed by " << killer.nickname() << " (" << reason << ')'
+#define QUIT(client, message) Reply(client) << " QUIT :" << message
+#define DIE(client) Reply(client) << " DIE: server terminated"
+#define PONG Reply() << "PONG " << SERVER_NAME
+#define KICK(kicker, channel, client, reason) Reply(kicker) << " KICK " << channel << ' ' << client << " :" << reason
+#define INVITE(client, nickname, channel) Reply(client) << " INVITE " << nickname << " :" << channel
+#define JOIN(client, nickname, channel) Reply(client) << " JOIN :" << channel
+#define PART(client, channelName) Reply(client) << " PART " << channelName
+#define PRIVMSG(client, channelName, message) Reply(client) << " PRIVMSG " << channelName << " :" << message
+#define ADDOP(client, recipient, channelName) Reply(client) << " PRIVMSG " << channelName << " :Client " << recipient << " added as " << channelName << " channel Operator by " << client.nickname()
+#define MODE(client, channelName, mode) Reply(client) << " MODE " << channelName << ' ' << mode
+#define NOTICE(target, message) Reply("NOTICE") << ' ' << target << " :" << message
+#define QUOTEGREETING(channelName) Reply() << ":QuoteBotAPI!QuoteBot@api.forismatic.com PRIVMSG " << channelName << " :QuoteBot is here to help you! Just type !quote"
 
 /* Structures */
-typedef std::pair<int, Client *>	client_pair_t;
-typedef std::map<int, Client *>		clients_t;
+typedef ClientTable		clients_t;
 
 /* Function prototypes */ 
 
@@ -121,7 +147,9 @@ void	                    handleCtrlD(void);
 int                         isDigits(const std::string& s);
 int                         isValidPort(const std::string& s);
 void                        printStr(const std::string& text, const std::string& colour);
-void 			            sendMSG(int fd, std::string RPL);
+void 			            sendMSG(Client &client, const std::string &RPL);
+void 			            sendMSG(Client &client, SharedBuffer *RPL);
+void 			            sendMSG(Client &client, const Reply &RPL);
 int                         isValidPassword(const std::string& pwd);
 
 // Logging
@@ -147,11 +175,60 @@ enum Command
     PASS,
     UNKNOWN,
     KILL,
-    DIE
+    DIE,
+    STATS,
+    LUSERS,
+    COMMAND_COUNT
 };
 
-std::map<std::string, Command>  createCommandMap();
-Command getCommandType(const std::string& cmd);
+#define CMD_REGISTERED	0x1	/* refused until PASS succeeded */
+#define CMD_OPER		0x2	/* IRC operators only */
+
+/* One entry of the command dispatch table (utils/command.cpp) */
+struct CommandSpec
+{
+	const char	*name;
+	size_t		length;
+	Command		type;
+	void		(MsgHandler::*handler)(const IrcMessage &msg, Client &client);
+	size_t		minParams;
+	int			flags;
+	size_t		cost;		/* flood control line tokens, unknown commands cost 1 */
+};
+
+const CommandSpec	*findCommand(const StringView &token);
+const char			*commandName(Command type);
+
+/*
+** Counters behind STATS. Every update happens with the server state lock
+** held (or before the event loops start), so they are plain integers bumped
+** in place; STATS reads them under the same lock.
+*/
+struct ServerStats
+{
+	std::time_t	startTime;
+	size_t		connections;		/* accepted since start */
+	size_t		registrations;		/* valid PASS */
+	size_t		usersOnline;		/* registered, bot excluded */
+	size_t		opersOnline;
+	size_t		unknownOnline;		/* connected, no valid PASS yet */
+	size_t		messages;			/* lines handed to respond() */
+	size_t		commands[COMMAND_COUNT];
+	size_t		bytesRead;
+	size_t		bytesWritten;
+	size_t		broadcasts;			/* channel fan-outs */
+	size_t		fanoutLines;		/* lines queued by fan-outs */
+	size_t		fanoutBytes;
+	size_t		shortWrites;		/* flushes that left output queued */
+	size_t		failedWrites;		/* sends that failed, dropping the client */
+	size_t		sendqEvictions;		/* clients dropped over their SendQ ceiling */
+	Histogram	latency[COMMAND_COUNT];	/* ns spent in respond(), per command */
+	Histogram	fanout;				/* recipients per broadcast */
+
+	/* last STATS t, for the recent message rate */
+	std::time_t	sampleTime;
+	size_t		sampleMessages;
+};
 
 /* Colours */
 #define RESET   "\e[0m"
@@ -4,7 +4,8 @@
 //                       Constructors & Desctructors                          //
 // ************************************************************************** //
 
-Channel::Channel(std::string name) : _channelName(name), 
+Channel::Channel(std::string name) : _operatorCount(0),
+									 _channelName(name),
 									 _channelPassword(""),
 									 _channelTopic("No topic set"),
 									 _channelTopicSetAt(""),
@@ -13,14 +14,29 @@ Channel::Channel(std::string name) : _channelName(name),
 									 _channelIsTopicRestricted(false),
 									 _channelIsKeyProtected(false),
 									 _channelIsLimitRestricted(false),
-									 _channelClientCount(0),
 									 _channelClientLimit(0) {}
 
 Channel::~Channel(void)
 {
-	info("Channel " + _channelName + " destroyed");
+	while (!_members.empty())
+		removeMember(_members[0]);
+	LOGF_INFO("Channel %s destroyed", _channelName);
 }
 
+SlabPool	&Channel::pool(void)
+{
+	static SlabPool	pool("Channel", sizeof(Channel), 64);
+	return (pool);
+}
+
+void	*Channel::operator new(size_t size)
+{
+	(void)size;
+	return (pool().allocate());
+}
+
+void	Channel::operator delete(void *block) { pool().release(block); }
+
 
 // ************************************************************************** //
 //                               Accessors                                    //
@@ -44,13 +60,13 @@ std::string	Channel::getTopicSetBy(void) const { return _channelTopicSetBy; }
 
 std::string	Channel::getTopic(void) const { return _channelTopic; }
 
-size_t	Channel::getClientCount(void) const { return _channelClientCount; }
+size_t	Channel::getClientCount(void) const { return _members.size(); }
 
 size_t	Channel::getClientLimit(void) const { return _channelClientLimit; }
 
-std::vector<Client *>&  Channel::getClients(void) { return _channelClients; }
+const MemberTable&	Channel::getMembers(void) const { return _members; }
 
-std::vector<Client *>&  Channel::getOperators(void) { return _channelOperators; }
+size_t	Channel::getOperatorCount(void) const { return _operatorCount; }
 
 void	Channel::setName(std::string &name) { _channelName = name; }
 
@@ -63,34 +79,20 @@ void	Channel::setTopic(std::string &topic, const std::string &nickname)
 	_channelTopicSetBy = nickname;
 }
 
-size_t	Channel::incClientCount(void) { return ++_channelClientCount; }
-
-size_t	Channel::decClientCount(void)
-{
-	if (_channelClientCount > 0)
-		return --_channelClientCount;
-	else
-	{
-		error("Client count is already 0");
-		return _channelClientCount;
-	}
-}
-
-
 // ************************************************************************** //
 //                             Public Functions                               //
 // ************************************************************************** //
 
-bool	Channel::isEmpty(void) const { return _channelClients.empty(); };
+bool	Channel::isEmpty(void) const { return _members.empty(); };
 
 void	Channel::setModeI(std::string &mode, Client &client)
 {
 	_channelIsInviteOnly = (mode == "+i");
-	broadcast(STD_PREFIX(client) + " MODE " + _channelName + " " + mode);
+	broadcast(MODE(client, _channelName, mode));
 	if (mode == "+i")
-		info("Channel " + _channelName + " is now invite only: " + boolToString(_channelIsInviteOnly));
+		LOGF_INFO("Channel %s is now invite only: %s", _channelName, (_channelIsInviteOnly ? "true" : "false"));
 	else if (mode == "-i")
-		info("Channel " + _channelName + " is no longer invite only");
+		LOGF_INFO("Channel %s is no longer invite only", _channelName);
 }
 
 void	Channel::setModeT(std::string &mode, Client &client)
@@ -98,74 +100,72 @@ void	Channel::setModeT(std::string &mode, Client &client)
 	if (mode == "+t")
 	{
 		_channelIsTopicRestricted = true;
-		info("Channel " + _channelName + " is now topic restricted");
+		LOGF_INFO("Channel %s is now topic restricted", _channelName);
 	}
 	else if (mode == "-t")
 	{
 		_channelIsTopicRestricted = false;
-		info("Channel " + _channelName + " is now topic unrestricted");
+		LOGF_INFO("Channel %s is now topic unrestricted", _channelName);
 	}
-	broadcast(STD_PREFIX(client) + " MODE " + _channelName + " " + mode);
+	broadcast(MODE(client, _channelName, mode));
 }
 
-void	Channel::setModeK(std::vector<std::string> &msgData, Client &client)
+void	Channel::setModeK(std::string &mode, const std::string &key, Client &client)
 {
-	std::string mode = msgData[2];
-
-	if (mode[0] == '+' && (msgData.size() != 4 || msgData[3].empty())) {
+	if (mode[0] == '+' && key.empty()) {
 		//sendMSG();
 		return ;
 	}
 	if (mode[0] == '+') {
 		_channelIsKeyProtected = true;
-		_channelPassword = msgData[3];
+		_channelPassword = key;
 	}
 	else {
 		_channelIsKeyProtected = false;
 		_channelPassword = "";
 	}
-	info("Channel " + _channelName + " is now key protected: " + boolToString(_channelIsKeyProtected));
-	broadcast(STD_PREFIX(client) + " MODE " + _channelName + " " + mode);
+	LOGF_INFO("Channel %s is now key protected: %s", _channelName, (_channelIsKeyProtected ? "true" : "false"));
+	broadcast(MODE(client, _channelName, mode));
 }
 
-void	Channel::setModeO(std::vector<std::string> &msgData, Client &client, Server &server)
+void	Channel::setModeO(std::string &mode, const std::string &nickname, Client &client, Server &server)
 {
-	std::string mode = msgData[2];
-
-	if (msgData.size() != 4) {
+	if (nickname.empty()) {
 		return ;
 	}
-	Client *recipient = server.getClientByNick(msgData[3]);
+	std::string target = nickname;
+	Client *recipient = server.getClientByNick(target);
 	if (!recipient) {
-		warning("Client with nickname " + msgData[3] + " not found");
-		return sendMSG(client.getFd(), ERR_NOSUCHNICK(client, msgData[3]));
+		LOGF_WARNING("Client with nickname %s not found", nickname);
+		return sendMSG(client, ERR_NOSUCHNICK(client, nickname));
+	}
+	if (!hasClient(recipient)) {
+		LOGF_WARNING("%s is not in channel %s", nickname, _channelName);
+		return sendMSG(client, ERR_USERNOTINCHANNEL(client, nickname, _channelName));
 	}
 	if (mode[0] == '+') {
 		addChanOp(recipient);	
-		broadcast(STD_PREFIX(client) + "Client " + recipient->nickname() + " added as " + _channelName + " channel Operator by " + client.nickname());
 		broadcast(ADDOP(client, recipient->nickname(), _channelName));
-		info("Client " + recipient->nickname() + " added as " + _channelName + " channel Operator by " + client.nickname());
+		LOGF_INFO("Client %s added as %s channel Operator by %s", recipient->nickname(), _channelName, client.nickname());
 	}
 	else {
 		removeChanOp(recipient);	
-		info("Client " + recipient->nickname() + "removed as " + _channelName + " channel Operator by " + client.nickname());
+		LOGF_INFO("Client %sremoved as %s channel Operator by %s", recipient->nickname(), _channelName, client.nickname());
 	}
-	broadcast(STD_PREFIX(client) + " MODE " + _channelName + " " + mode);
+	broadcast(MODE(client, _channelName, mode));
 }
 
-void	Channel::setModeL(std::vector<std::string> &msgData, Client &client)
+void	Channel::setModeL(std::string &mode, const std::string &limit, Client &client)
 {
-	std::string mode = msgData[2];
-
-	if (mode[0] == '+' && (msgData.size() != 4 || msgData[3].empty()))
+	if (mode[0] == '+' && limit.empty())
 	{
-		sendMSG(client.getFd(), ERR_BADCHANNELKEY(client, _channelName));
+		sendMSG(client, ERR_BADCHANNELKEY(client, _channelName));
 		return ;
 	}
 	if (mode[0] == '+')
 	{
 		_channelIsLimitRestricted = true;
-		std::stringstream size(msgData[3]);
+		std::stringstream size(limit);
 		size >> _channelClientLimit;
 	}
 	else if(mode[0] == '-') 
@@ -173,73 +173,102 @@ void	Channel::setModeL(std::vector<std::string> &msgData, Client &client)
 		_channelIsLimitRestricted = false;
 		_channelClientLimit = 0;
 	}
-	info("Channel " + _channelName + " is now limit restricted (currently " + sizeToString(_channelClientCount) + "/" +sizeToString(_channelClientLimit) + "): " + boolToString(_channelIsLimitRestricted));
-	broadcast(STD_PREFIX(client) + " MODE " + _channelName + " " + mode);
+	LOGF_INFO("Channel %s is now limit restricted (currently %zu/%zu): %s", _channelName, _members.size(), _channelClientLimit, (_channelIsLimitRestricted ? "true" : "false"));
+	broadcast(MODE(client, _channelName, mode));
 }
 
-bool	Channel::hasClient(Client* client) const
+bool	Channel::hasClient(Client* client) const { return (_members.find(client) != NULL); }
+
+bool    Channel::isClientChanOp(Client* client) const
 {
-	for (std::vector<Client *>::const_iterator it = _channelClients.begin(); \
-										   it != _channelClients.end(); ++it) {
-		if (*it == client)
-			return true;
-	}
-	return false;
+	Membership *member = _members.find(client);
+	return (member && (member->flags & MEMBER_OP));
 }
 
-bool    Channel::isClientChanOp(Client* client) const
+Membership	*Channel::findMember(const Client *client) const { return (_members.find(client)); }
+
+/* NULL, with nothing changed on either side, if the client is already in */
+Membership	*Channel::addMember(Client *client, int flags)
 {
-	for (std::vector<Client *>::const_iterator it = _channelOperators.begin(); \
-										it != _channelOperators.end(); ++it)
+	Membership *member = new Membership();
+	member->client = client;
+	member->channel = this;
+	member->flags = flags;
+	if (!_members.insert(member))
 	{
-		if (*it == client)
-			return true;
+		delete member;
+		return (NULL);
 	}
-	return false;
+	client->addMembership(member);
+	if (flags & MEMBER_OP)
+		_operatorCount++;
+	return (member);
+}
+
+void	Channel::removeMember(Membership *member)
+{
+	_members.erase(member);
+	member->client->dropMembership(member);
+	if (member->flags & MEMBER_OP)
+		_operatorCount--;
+	delete member;
 }
 
 void	Channel::addChanOp(Client* client)
 {
-	if (isClientChanOp(client))
-		return warning(client->nickname() + " is already an operator in channel " + _channelName);
-	_channelOperators.push_back(client);
-	broadcast(client->nickname() + " is now channel operator");
-	info(client->nickname() + " is now an operator in channel " + _channelName);
+	Membership *member = _members.find(client);
+	if (!member)
+		return LOGF_WARNING("%s is not in channel %s", client->nickname(), _channelName);
+	if (member->flags & MEMBER_OP)
+		return LOGF_WARNING("%s is already an operator in channel %s", client->nickname(), _channelName);
+	member->flags |= MEMBER_OP;
+	_operatorCount++;
+	broadcast(NOTICE(_channelName, client->nickname()) << " is now channel operator");
+	LOGF_INFO("%s is now an operator in channel %s", client->nickname(), _channelName);
 }
 
 void	Channel::removeChanOp(Client* client)
 {
 	if (client->isIRCOp())
-		return warning(client->nickname() + " is a global operator");
-	if (!isClientChanOp(client))
-		return warning(client->nickname() + " is not an operator in channel " + _channelName);
-	for (std::vector<Client *>::iterator it = _channelOperators.begin(); it != _channelOperators.end(); ++it) {
-		if (*it == client) {
-			_channelOperators.erase(it);
-			return;
-		}
-	}
-	broadcast(client->nickname() + " has been removed as channel operator");
-	info(client->nickname() + " is no longer an operator in channel " + _channelName);
+		return LOGF_WARNING("%s is a global operator", client->nickname());
+	Membership *member = _members.find(client);
+	if (!member || !(member->flags & MEMBER_OP))
+		return LOGF_WARNING("%s is not an operator in channel %s", client->nickname(), _channelName);
+	member->flags &= ~MEMBER_OP;
+	_operatorCount--;
+	broadcast(NOTICE(_channelName, client->nickname()) << " has been removed as channel operator");
+	LOGF_INFO("%s is no longer an operator in channel %s", client->nickname(), _channelName);
 }
 
-void	Channel::broadcast(std::string message)
+static void	countFanout(size_t lines, size_t length)
 {
-	if (message.empty())
-		return warning("Empty message");
-	for (std::vector<Client *>::const_iterator it = _channelClients.begin(); it != _channelClients.end(); ++it) {
-		sendMSG((*it)->getFd(), (message + "\r\n"));
-	}
+	Server::stats.broadcasts++;
+	Server::stats.fanoutLines += lines;
+	Server::stats.fanoutBytes += lines * length;
+	Server::stats.fanout.record(lines);
 }
 
-void	Channel::broadcastSilent(std::string message, Client *client)
+void	Channel::broadcast(const Reply &message)
 {
-	if (message.empty())
-		return warning("Empty message");
-	for (std::vector<Client *>::const_iterator it = _channelClients.begin(); it != _channelClients.end(); ++it) {
-		if (*it == client) {
-			continue ;
+	SharedBuffer *line = SharedBuffer::create(message.data(), message.size());
+	for (size_t i = 0; i < _members.size(); i++)
+		sendMSG(*_members[i]->client, line);
+	line->release();
+	countFanout(_members.size(), message.size());
+}
+
+void	Channel::broadcastSilent(const Reply &message, Client *client)
+{
+	SharedBuffer *line = SharedBuffer::create(message.data(), message.size());
+	size_t		sent = 0;
+	for (size_t i = 0; i < _members.size(); i++)
+	{
+		if (_members[i]->client != client)
+		{
+			sendMSG(*_members[i]->client, line);
+			sent++;
 		}
-		sendMSG((*it)->getFd(), (message + "\r\n"));
 	}
+	line->release();
+	countFanout(sent, message.size());
 }
@@ -8,8 +8,9 @@ ChannelManager::ChannelManager(Server &server) : _server(server), _channelCount(
 
 ChannelManager::~ChannelManager(void)
 {
-	for (channels_t::iterator it = _channels.begin(); it != _channels.end(); ++it) {
-		delete it->second;
+	for (size_t i = 0; i < _channels.capacity(); i++) {
+		if (_channels.occupied(i))
+			delete _channels.valueAt(i);
 	}
 	_channels.clear();
 }
@@ -30,7 +31,7 @@ size_t	ChannelManager::decChannelCount(void)
 	if (_channelCount > 0)
 		return --_channelCount;
 	else {
-		error("Channel count is already 0");
+		LOGF_ERROR("Channel count is already 0");
 		return _channelCount;
 	}
 }
@@ -40,55 +41,57 @@ size_t	ChannelManager::decChannelCount(void)
 //                             Public Functions                               //
 // ************************************************************************** //
 
-bool	ChannelManager::channelExists(const std::string& channelName) const { return _channels.find(channelName) != _channels.end(); }
+bool	ChannelManager::channelExists(const std::string& channelName) const { return _channels.find(channelName) != NULL; }
 
+/*
+** Channel names are case-insensitive (RFC 1459 case mapping); the lookup
+** folds the name as it probes and allocates nothing.
+*/
 Channel*	ChannelManager::getChanByName(const std::string& channelName)
 {
-	channels_t::iterator it = _channels.find(channelName);
-	if (it != _channels.end())
-		return it->second;
-	return NULL;
+	Channel **channel = _channels.find(channelName);
+	return (channel ? *channel : NULL);
 }
 
 Channel	*ChannelManager::createChannel(const std::string &channelName)
 {
     Channel *newChannel = new Channel(channelName);
-	_channels.insert(channel_pair_t (channelName, newChannel));
-	info("Channel created: " + channelName);
+	_channels[channelName] = newChannel;
+	LOGF_INFO("Channel created: %s", channelName);
 	incChannelCount();
 	return (newChannel);
 }
 
 void	ChannelManager::deleteChannel(const std::string &channelName)
 {
-	channels_t::iterator it = _channels.find(channelName);
-	if (it != _channels.end())
+	Channel *channel = getChanByName(channelName);
+	if (channel)
 	{
-		delete it->second;
-		_channels.erase(it);
-		info("Channel deleted: " + channelName);
+		_channels.erase(channelName);
+		LOGF_INFO("Channel deleted: %s", channelName);
+		delete channel;
 		decChannelCount();
 	}
 	else
-		warning("Channel " + channelName + " does not exist");
+		LOGF_WARNING("Channel %s does not exist", channelName);
 }
 
 bool ChannelManager::chanRestrictionsFail(Client& client, const std::string& channelName, std::string &channelKey)
 {
-	Channel* channel = _channels[channelName];
+	Channel* channel = getChanByName(channelName);
 
 	if (channel->isLimitRestricted() && (channel->getClientCount() >= channel->getClientLimit())) 
 	{
-		sendMSG(client.getFd(), ERR_CHANNELISFULL(client, channelName));
+		sendMSG(client, ERR_CHANNELISFULL(client, channelName));
 		return (true);
 	}
 	if (channel->isKeyProtected() && channelKey != channel->getPasskey()) {
-		sendMSG(client.getFd(), ERR_BADCHANNELKEY(client, channelName));
+		sendMSG(client, ERR_BADCHANNELKEY(client, channelName));
 		return (true);
 	}
-	if (channel->isInviteOnly() && !(client.isInvited(channelName) || channel->isClientChanOp(&client) || client.isIRCOp()))
+	if (channel->isInviteOnly() && !(client.isInvited(channel->getName()) || channel->isClientChanOp(&client) || client.isIRCOp()))
 	{
-		sendMSG(client.getFd(), ERR_INVITEONLYCHAN(client, channelName));
+		sendMSG(client, ERR_INVITEONLYCHAN(client, channelName));
 		return (true);
 	}
 	return (false);
@@ -97,24 +100,23 @@ bool ChannelManager::chanRestrictionsFail(Client& client, const std::string& cha
 void	ChannelManager::addToChannel(std::string &channelName, std::string &channelKey, Client &client)
 {
 	Channel	*channel = getChanByName(channelName);
+	int		flags = 0;
 
 	if (!channel) {
 		channel = createChannel(channelName);
-		channel->addChanOp(&client);
+		flags = MEMBER_OP;
 	}
 	if (chanRestrictionsFail(client, channelName, channelKey) || channel->hasClient(&client)) {
 		return ;
 	}
-	channel->getClients().push_back(&client);
-	channel->incClientCount();
-	client.getClientChannels().push_back(channel);
-	client.delChannelInvite(channelName);
-	info(client.nickname() + " joined channel " + channelName);
-	sendMSG(client.getFd(), RPL_TOPIC(client, channel->getName(), channel->getTopic()));
+	channel->addMember(&client, flags);
+	client.delChannelInvite(channel->getName());
+	LOGF_INFO("%s joined channel %s", client.nickname(), channelName);
+	sendMSG(client, RPL_TOPIC(client, channel->getName(), channel->getTopic()));
 	if (channel->getTopic() != "No topic set") {
-		sendMSG(client.getFd(), RPL_TOPICWHOTIME(client, channel->getName(), channel->getTopicSetBy(), channel->getTopicSetAt()));
+		sendMSG(client, RPL_TOPICWHOTIME(client, channel->getName(), channel->getTopicSetBy(), channel->getTopicSetAt()));
 	}
-	sendMSG(client.getFd(), QUOTEGREETING(channel->getName()));
+	sendMSG(client, QUOTEGREETING(channel->getName()));
 }
 
 void ChannelManager::removeFromChannel(const std::string& channelName, Client& client)
@@ -122,31 +124,25 @@ void ChannelManager::removeFromChannel(const std::string& channelName, Client& c
     Channel* channel = getChanByName(channelName);
 
 	if (!channel) {
-		sendMSG(client.getFd(), ERR_NOSUCHCHANNEL(client, channelName));
-		return warning("Channel " + channelName + " does not exist");
+		sendMSG(client, ERR_NOSUCHCHANNEL(client, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
     }
-    std::vector<Client*>& channelClients = channel->getClients();
-    std::vector<Client*>::iterator clientIt = std::find(channelClients.begin(), channelClients.end(), &client);
-    if (clientIt == channelClients.end()) {
-		sendMSG(client.getFd(), ERR_NOTONCHANNEL(client, channelName));
-		return warning(client.nickname() + " is not an operator in channel " + channelName);
+    Membership *member = channel->findMember(&client);
+    if (!member) {
+		sendMSG(client, ERR_NOTONCHANNEL(client, channelName));
+		return LOGF_WARNING("%s is not an operator in channel %s", client.nickname(), channelName);
 	}
 
-    channelClients.erase(clientIt);
-    channel->decClientCount();
-    channel->broadcast(PART(client, channelName)); 
-    sendMSG(client.getFd(), RPL_NOTINCHANNEL(client, channelName));
-    info(client.nickname() + " removed from channel " + channelName);
-    client.popClientChannel(*this, channelName);
+    channel->removeMember(member);
+    channel->broadcast(PART(client, channel->getName())); 
+    sendMSG(client, RPL_NOTINCHANNEL(client, channel->getName()));
+    LOGF_INFO("%s removed from channel %s", client.nickname(), channel->getName());
 
-    if (channel->isClientChanOp(&client)) {
-        channel->removeChanOp(&client);
-	}
-    if (channel->getClients().empty()) {
-        deleteChannel(channelName);
+    if (channel->isEmpty()) {
+        deleteChannel(channel->getName());
 	}
-	else if (channel->getOperators().empty()) {
-		channel->addChanOp(channel->getClients().front());
+	else if (channel->getOperatorCount() == 0) {
+		channel->addChanOp(channel->getMembers()[0]->client);
 	}
 }
 
@@ -155,21 +151,21 @@ void	ChannelManager::kickFromChannel(std::string &channelName, std::string &user
 	Channel* chan = getChanByName(channelName);
 	if (!chan)
 	{
-		sendMSG(kicker.getFd(), ERR_NOSUCHCHANNEL(kicker, channelName));
-		return warning("Channel " + channelName + " does not exist");
+		sendMSG(kicker, ERR_NOSUCHCHANNEL(kicker, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
 	}
 	if (!chan->isClientChanOp(&kicker) && !kicker.isIRCOp())
 	{
-		sendMSG(kicker.getFd(), ERR_CHANOPPROVSNEEDED(kicker, channelName));
-		return warning(kicker.nickname() + " is not an operator in channel " + channelName);
+		sendMSG(kicker, ERR_CHANOPPROVSNEEDED(kicker, channelName));
+		return LOGF_WARNING("%s is not an operator in channel %s", kicker.nickname(), channelName);
 	}
 	Client *client = _server.getClientByNick(userToKick);
 	if (client)
 	{
-		chan->broadcast(KICK(kicker, channelName, client->nickname(), reason));
+		chan->broadcast(KICK(kicker, chan->getName(), client->nickname(), reason));
 		removeFromChannel(channelName, *client);
 	}
-	info(kicker.nickname() + " kicked " + userToKick + " from channel " + channelName);
+	LOGF_INFO("%s kicked %s from channel %s", kicker.nickname(), userToKick, channelName);
 }
 
 void	ChannelManager::inviteClient(std::string &channelName, std::string &nickname, Client &client)
@@ -177,55 +173,58 @@ void	ChannelManager::inviteClient(std::string &channelName, std::string &nicknam
   	Channel* chan = getChanByName(channelName);
 	if (!chan)
 	{
-		sendMSG(client.getFd(), ERR_NOSUCHCHANNEL(client, channelName));
-		return warning("Channel " + channelName + " does not exist");
+		sendMSG(client, ERR_NOSUCHCHANNEL(client, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
 	}
 	if (!chan->isClientChanOp(&client) && !client.isIRCOp())
 	{
-		sendMSG(client.getFd(), ERR_CHANOPPROVSNEEDED(client, channelName));
-		return warning(client.nickname() + " is not an operator in channel " + channelName);
+		sendMSG(client, ERR_CHANOPPROVSNEEDED(client, channelName));
+		return LOGF_WARNING("%s is not an operator in channel %s", client.nickname(), channelName);
 	}
 	Client* targetClient = _server.getClientByNick(nickname);
 	if (!targetClient)
 	{
-		sendMSG(client.getFd(), ERR_NOSUCHNICK(client, channelName));
-		return warning("Client " + nickname + " not found");
+		sendMSG(client, ERR_NOSUCHNICK(client, channelName));
+		return LOGF_WARNING("Client %s not found", nickname);
 	}
-	sendMSG(targetClient->getFd(), INVITE(client, nickname, channelName));
-	sendMSG(client.getFd(), RPL_INVITING(client, nickname, channelName));
-	targetClient->addChannelInvite(channelName);
-	info(client.nickname() + " invited " + nickname + " to channel " + channelName);
+	sendMSG(*targetClient, INVITE(client, nickname, channelName));
+	sendMSG(client, RPL_INVITING(client, nickname, channelName));
+	targetClient->addChannelInvite(chan->getName());
+	LOGF_INFO("%s invited %s to channel %s", client.nickname(), nickname, channelName);
 }
 
 void	ChannelManager::forwardPrivateMessage(std::string &channelName, std::string &message, Client &client)
 {
-	std::map<std::string, Channel*> allChannels = getChannels();
-
-	std::map<std::string, Channel*>::iterator it = allChannels.find(channelName);
-	if (it == allChannels.end())
+	Channel* channel = getChanByName(channelName);
+	if (!channel)
 	{
-		sendMSG(client.getFd(), ERR_NOSUCHCHANNEL(client, channelName));
-        return warning("PRIVMSG channel is missing or invalid");
+		sendMSG(client, ERR_NOSUCHCHANNEL(client, channelName));
+        return LOGF_WARNING("PRIVMSG channel is missing or invalid");
 	}
-	Channel* channel = it->second;
 	if (!channel->hasClient(&client) && !client.isBot()) {
-		sendMSG(client.getFd(), ERR_NOTONCHANNEL(client, channelName));
-		warning("client" + client.nickname() + " not in channel " + channelName);
+		sendMSG(client, ERR_NOTONCHANNEL(client, channelName));
+		LOGF_WARNING("client%s not in channel %s", client.nickname(), channelName);
 	}
 	if (channel->isEmpty())
-		return warning("Channel is ");
-	channel->broadcastSilent(PRIVMSG(client, channelName, message), &client);
+		return LOGF_WARNING("Channel is ");
+	channel->broadcastSilent(PRIVMSG(client, channel->getName(), message), &client);
 }
 
-void	ChannelManager::setChanMode(std::vector<std::string> &msgData, Client &client)
+/*
+** MODE <channel> <+|-><i|t|k|o|l> [argument]
+*/
+void	ChannelManager::setChanMode(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 3 || msgData[2].length() != 2 || !strchr("+-", msgData[2][0]) || !strchr("itkol", msgData[2][1]))
+	StringView	modeView = msg.param(1);
+
+	if (modeView.size != 2 || !strchr("+-", modeView.data[0]) || !strchr("itkol", modeView.data[1]))
 	{
-		sendMSG(client.getFd(), ERR_UNKNOWNMODE(client, msgData[2]));
-		return warning("Invalid mode: " + msgData[1] + ". +/- {i, t, k, o, l}");
+		sendMSG(client, ERR_UNKNOWNMODE(client, modeView.str()));
+		return LOGF_WARNING("Invalid mode: %s. +/- {i, t, k, o, l}", msg.arg(0));
 	}
-	std::string channelName = msgData[1];
-	std::string mode = msgData[2];
+	std::string channelName = msg.arg(0);
+	std::string mode = modeView.str();
+	std::string argument = msg.arg(2);
 
 	Channel *channel = getChanByName(channelName);
 	if (mode[1] == 'i')
@@ -233,9 +232,9 @@ void	ChannelManager::setChanMode(std::vector<std::string> &msgData, Client &clie
 	else if (mode[1] == 't')
 		channel->setModeT(mode, client);
 	else if (mode[1] == 'k')
-		channel->setModeK(msgData, client);
+		channel->setModeK(mode, argument, client);
 	else if (mode[1] == 'o')
-		channel->setModeO(msgData, client, _server);
+		channel->setModeO(mode, argument, client, _server);
 	else if (mode[1] == 'l')
-		channel->setModeL(msgData, client);
+		channel->setModeL(mode, argument, client);
 }
\ No newline at end of file
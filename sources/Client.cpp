@@ -4,19 +4,40 @@
 //                       Constructors & Desctructors                          //
 // ************************************************************************** //
 
-Client::Client(pollfd clientSocket)
+Client::Client(pollfd clientSocket, size_t inputSize) : _input(inputSize)
 {
 	_nickname = "undefined";
 	_username = "undefined";
 	_socket = clientSocket;
+	_loop = NULL;
 	_isRegistered = false;
 	_isIRCOp = false;
 	_isBot = false;
-	msgBuffer = "";
+	_isDisconnected = false;
+	_isDirty = false;
+	_isThrottled = false;
+	_isSendqExceeded = false;
+	_sendqLimit = 0;
+	_throttledPos = 0;
+	_updatePrefix();
 }
 
 Client::~Client() {}
 
+SlabPool	&Client::pool(void)
+{
+	static SlabPool	pool("Client", sizeof(Client), 64);
+	return (pool);
+}
+
+void	*Client::operator new(size_t size)
+{
+	(void)size;
+	return (pool().allocate());
+}
+
+void	Client::operator delete(void *block) { pool().release(block); }
+
 
 // ************************************************************************** //
 //                               Accessors                                    //
@@ -26,23 +47,60 @@ pollfd	Client::getSocket() const { return (_socket); }
 
 int	Client::getFd() const { return (_socket.fd); }
 
-std::string	Client::username() const { return (_username); }
+EventLoop*	Client::getLoop() const { return (_loop); }
+
+void	Client::setLoop(EventLoop *loop) { _loop = loop; }
+
+void	Client::setEvents(short events) { _socket.events = events; }
+
+SendQueue&	Client::getSendQueue() { return (_sendQueue); }
+
+SendQueue&	Client::getOutgoing() { return (_outgoing); }
+
+size_t	Client::queuedBytes() const { return (_sendQueue.size() + _outgoing.size()); }
+
+InputBuffer&	Client::getInput() { return (_input); }
+
+TokenBucket&	Client::getLineTokens() { return (_lineTokens); }
+
+TokenBucket&	Client::getByteTokens() { return (_byteTokens); }
 
-std::string	Client::nickname() const { return (_nickname); }
+size_t	Client::getSendqLimit() const { return (_sendqLimit); }
 
-std::string	Client::hostname() const { return (_hostname); }
+void	Client::setSendqLimit(size_t limit) { _sendqLimit = limit; }
+
+size_t	Client::getThrottledPos() const { return (_throttledPos); }
+
+void	Client::setThrottledPos(size_t pos) { _throttledPos = pos; }
+
+const std::string	&Client::username() const { return (_username); }
+
+const std::string	&Client::nickname() const { return (_nickname); }
+
+const std::string	&Client::hostname() const { return (_hostname); }
+
+const std::string	&Client::prefix() const { return (_prefix); }
 
 void	Client::setFullName(std::string &fullname) { _fullname = fullname; }
 
 void	Client::setNickname(std::string &nickname)
 {
 	_nickname = nickname;
-	info("Client " + this->nickname() + "'s nickname was set to "	+ nickname);
+	_updatePrefix();
+	LOGF_INFO("Client %s's nickname was set to %s", this->nickname(), nickname);
 }
 
-void	Client::setUsername(std::string &username) { _username = username; }
+void	Client::setUsername(std::string &username)
+{
+	_username = username;
+	_updatePrefix();
+}
 
-void	Client::setHostname(std::string &hostname) { _hostname = hostname; }
+void	Client::setHostname(std::string &hostname)
+{
+	_hostname = hostname;
+	_updatePrefix();
+}
 
 void	Client::setIP(std::string IP) { _IP = IP; }
 
@@ -52,13 +110,30 @@ void	Client::setRegistered(bool status) { _isRegistered = status; }
 
 void	Client::setBot(bool status) { _isBot = status; }
 
+void	Client::setDisconnected(bool status) { _isDisconnected = status; }
+
+void	Client::setDirty(bool status) { _isDirty = status; }
+
+void	Client::setThrottled(bool status) { _isThrottled = status; }
+
+void	Client::setSendqExceeded(bool status) { _isSendqExceeded = status; }
+
 bool	Client::isRegistered() const { return (_isRegistered); }
 
 bool	Client::isIRCOp() const { return _isIRCOp; }
 
 
 bool	Client::isBot() const { return _isBot; }
-std::vector<Channel*>&	Client::getClientChannels() { return (_clientChannels); }
+
+bool	Client::isDisconnected() const { return _isDisconnected; }
+
+bool	Client::isDirty() const { return _isDirty; }
+
+bool	Client::isThrottled() const { return _isThrottled; }
+
+bool	Client::isSendqExceeded() const { return _isSendqExceeded; }
+
+const std::vector<Membership *>&	Client::getMemberships() const { return (_memberships); }
 
 
 std::vector<std::string>	Client::getChannelInvites() const { return (_clientChannelInvites); }
@@ -77,31 +152,89 @@ void	Client::delChannelInvite(const std::string& channelName)
 }
 
 
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/*
+** ":nick!user@host", the source of every line this client sends to others.
+** Kept serialized here and rebuilt only when one of its parts changes.
+*/
+void	Client::_updatePrefix(void)
+{
+	_prefix.clear();
+	_prefix.reserve(_nickname.size() + _username.size() + _hostname.size() + 3);
+	_prefix.append(1, ':').append(_nickname).append(1, '!').append(_username).append(1, '@').append(_hostname);
+}
+
+
 // ************************************************************************** //
 //                             Public Functions                               //
 // ************************************************************************** //
 
-void	Client::popClientChannel(ChannelManager& manager,std::string channelName)
+/*
+** Other shards queue replies on _sendQueue; _outgoing is only ever touched by
+** the owning loop, which moves everything queued over, with the state lock
+** held, before writing it out.
+*/
+SendQueue&	Client::takeOutput(void)
+{
+	_outgoing.splice(_sendQueue);
+	return (_outgoing);
+}
+
+/*
+** The client's side of its channel memberships, kept by Channel::addMember
+** and Channel::removeMember. Removal moves the last entry into the gap.
+*/
+void	Client::addMembership(Membership *member)
+{
+	member->channelPos = _memberships.size();
+	_memberships.push_back(member);
+}
+
+void	Client::dropMembership(Membership *member)
+{
+	Membership	*last = _memberships.back();
+
+	_memberships[member->channelPos] = last;
+	last->channelPos = member->channelPos;
+	_memberships.pop_back();
+}
+
+/*
+** Flood control: a line may be processed while both the line and the byte
+** bucket hold tokens. IRC operators are not limited.
+*/
+bool	Client::hasTokens(uint64_t now)
+{
+	bool	lines = _lineTokens.available(now);
+	bool	bytes = _byteTokens.available(now);
+
+	return (_isIRCOp || (lines && bytes));
+}
+
+void	Client::spendTokens(size_t lines, size_t bytes)
+{
+	_lineTokens.spend(lines);
+	_byteTokens.spend(bytes);
+}
+
+uint64_t	Client::tokenDelay(void) const
 {
-	Channel* chan = manager.getChanByName(channelName);
-	std::vector<Channel*>::iterator it = std::find(_clientChannels.begin(), 
-												   _clientChannels.end(), chan);
-	if (it != _clientChannels.end())
-		_clientChannels.erase(it);
-	info(_nickname + " has left channel " + channelName);
+	return (std::max(_lineTokens.refillDelay(), _byteTokens.refillDelay()));
 }
 
-void	Client::assignUserData(std::string &username, std::string &hostname, std::string &IP, std::string &fullName)
+void	Client::assignUserData(std::string &hostname, std::string &IP, std::string &fullName)
 {
-	setUsername(username);
 	setHostname(hostname);
 	setIP(IP);
 	setFullName(fullName);
 
-	sendMSG(this->getFd(), RPL_WELCOME((*this)));
-	sendMSG(this->getFd(), RPL_YOURHOST((*this)));
-	sendMSG(this->getFd(), RPL_CREATED((*this)));
-	sendMSG(this->getFd(), RPL_MYINFO((*this)));
+	sendMSG(*this, RPL_WELCOME((*this)));
+	sendMSG(*this, RPL_YOURHOST((*this)));
+	sendMSG(*this, RPL_CREATED((*this)));
+	sendMSG(*this, RPL_MYINFO((*this)));
 }
 
 bool	Client::isInvited(const std::string& channelName) const
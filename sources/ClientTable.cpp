@@ -0,0 +1,55 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+ClientTable::ClientTable(void) {}
+
+ClientTable::~ClientTable(void) {}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+size_t	ClientTable::size(void) const { return (_clients.size()); }
+
+bool	ClientTable::empty(void) const { return (_clients.empty()); }
+
+Client	*ClientTable::operator[](size_t i) const { return (_clients[i]); }
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+Client	*ClientTable::find(int fd) const
+{
+	if (fd < 0 || (size_t)fd >= _position.size() || _position[fd] < 0)
+		return (NULL);
+	return (_clients[_position[fd]]);
+}
+
+void	ClientTable::insert(Client *client)
+{
+	int	fd = client->getFd();
+
+	if ((size_t)fd >= _position.size())
+		_position.resize(fd + 1, -1);
+	if (_position[fd] >= 0)
+		return ;
+	_position[fd] = _clients.size();
+	_clients.push_back(client);
+}
+
+void	ClientTable::erase(int fd)
+{
+	if (fd < 0 || (size_t)fd >= _position.size() || _position[fd] < 0)
+		return ;
+	int		i = _position[fd];
+	Client	*last = _clients.back();
+
+	_clients[i] = last;
+	_position[last->getFd()] = i;
+	_clients.pop_back();
+	_position[fd] = -1;
+}
@@ -0,0 +1,118 @@
+#include "../include/irc.hpp"
+#include "../include/EpollBackend.hpp"
+
+/*
+** Level-triggered epoll. The kernel hands back the fd of every ready socket
+** and the registration pointer is kept in a table indexed by that fd, so a
+** wakeup costs O(ready) no matter how many sockets are registered.
+*/
+
+static uint32_t	toEpoll(short events)
+{
+	uint32_t	mask = 0;
+
+	if (events & POLLIN)
+		mask |= EPOLLIN;
+	if (events & POLLOUT)
+		mask |= EPOLLOUT;
+	return (mask);
+}
+
+static short	fromEpoll(uint32_t mask)
+{
+	short	events = 0;
+
+	if (mask & EPOLLIN)
+		events |= POLLIN;
+	if (mask & EPOLLOUT)
+		events |= POLLOUT;
+	if (mask & EPOLLHUP)
+		events |= POLLHUP;
+	if (mask & EPOLLERR)
+		events |= POLLERR;
+	return (events);
+}
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+EpollBackend::EpollBackend(void) : _registered(0)
+{
+	_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (_epollFd < 0)
+		warning("epoll_create1 failed: " + std::string(strerror(errno)));
+}
+
+EpollBackend::~EpollBackend(void)
+{
+	if (_epollFd >= 0)
+		close(_epollFd);
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+bool	EpollBackend::isOpen(void) const { return (_epollFd >= 0); }
+
+const char	*EpollBackend::name(void) const { return "epoll"; }
+
+bool	EpollBackend::add(int fd, short events, void *data)
+{
+	epoll_event	ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = toEpoll(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		return (error("epoll_ctl(ADD) failed: " + std::string(strerror(errno))), false);
+	if ((size_t)fd >= _data.size())
+		_data.resize(fd + 1, NULL);
+	_data[fd] = data;
+	_registered++;
+	return (true);
+}
+
+bool	EpollBackend::modify(int fd, short events, void *data)
+{
+	epoll_event	ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = toEpoll(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) < 0)
+		return (false);
+	_data[fd] = data;
+	return (true);
+}
+
+void	EpollBackend::remove(int fd)
+{
+	if (epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, NULL) < 0)
+		return ;
+	_data[fd] = NULL;
+	_registered--;
+}
+
+int	EpollBackend::wait(std::vector<IOEvent> &ready, int timeout)
+{
+	ready.clear();
+	if (_events.size() < _registered)
+		_events.resize(_registered);
+	if (_events.empty())
+		_events.resize(1);
+
+	int activity = epoll_wait(_epollFd, _events.data(), _events.size(), timeout);
+	for (int i = 0; i < activity; i++)
+	{
+		IOEvent	event;
+		event.fd = _events[i].data.fd;
+		event.events = fromEpoll(_events[i].events);
+		event.data = _data[event.fd];
+		event.result = 0;
+		event.buffer = NULL;
+		ready.push_back(event);
+	}
+	return (activity);
+}
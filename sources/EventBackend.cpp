@@ -0,0 +1,34 @@
+#include "../include/irc.hpp"
+#include "../include/PollBackend.hpp"
+#include "../include/EpollBackend.hpp"
+#include "../include/IoUringBackend.hpp"
+
+// ************************************************************************** //
+//                             Static Functions                               //
+// ************************************************************************** //
+
+EventBackend	*EventBackend::create(const Server &server)
+{
+	std::string	name = server.getConfig("event_backend", "epoll");
+
+	if (name == "poll")
+		return new PollBackend();
+	if (name == "io_uring")
+	{
+		IoUringBackend *uring = new IoUringBackend(server.getConfigSize("uring_buffers", 256),
+			server.getConfigSize("uring_buffer_size", 4096));
+		if (uring->isOpen())
+			return uring;
+		delete uring;
+		warning("io_uring unavailable, trying epoll");
+	}
+	else if (name != "epoll")
+		warning("Unknown event backend '" + name + "', trying epoll");
+
+	EpollBackend *epoll = new EpollBackend();
+	if (epoll->isOpen())
+		return epoll;
+	delete epoll;
+	warning("epoll unavailable, falling back to poll");
+	return new PollBackend();
+}
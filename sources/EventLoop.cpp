@@ -0,0 +1,561 @@
+#include "../include/irc.hpp"
+#include <sys/eventfd.h>
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+EventLoop::EventLoop(Server &server, size_t id, unsigned int port, bool reusePort)
+	: _server(server), _id(id), _listenFd(-1), _wakeFd(-1), _thread(pthread_self()),
+	_written(0), _shortWrites(0), _resumeAt(0)
+{
+	_sendqPause = server.getConfigSize("sendq_pause", 65536);
+	_backend = EventBackend::create(server);
+	_openListener(port, reusePort);
+	_backend->listen(_listenFd);
+
+	_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_wakeFd < 0)
+		warning("eventfd failed: " + std::string(strerror(errno)));
+	else
+		_backend->add(_wakeFd, POLLIN, NULL);
+}
+
+EventLoop::~EventLoop(void)
+{
+	_closeReleased();
+	_reapDisconnected();
+	close(_listenFd);
+	if (_wakeFd >= 0)
+		close(_wakeFd);
+	delete _backend;
+}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+size_t	EventLoop::getId(void) const { return (_id); }
+
+int	EventLoop::getListenFd(void) const { return (_listenFd); }
+
+EventBackend&	EventLoop::getBackend(void) { return (*_backend); }
+
+bool	EventLoop::isCurrentThread(void) const { return (pthread_equal(_thread, pthread_self())); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/* A shard that cannot listen would run on a dead socket: give up instead */
+static void	listenerFailure(const char *call)
+{
+	error(std::string("Listener ") + call + " failed: " + strerror(errno));
+	Logger::stop();
+	exit(-1);
+}
+
+void	EventLoop::_openListener(unsigned int port, bool reusePort)
+{
+	_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if (_listenFd < 0)
+		listenerFailure("socket");
+
+	sockaddr_in	serverAddr;
+	memset(&serverAddr, 0, sizeof(serverAddr));
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+	serverAddr.sin_port = htons(port);
+
+	int opt = 1;
+	setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	if (reusePort && setsockopt(_listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+		listenerFailure("SO_REUSEPORT");
+	if (fcntl(_listenFd, F_SETFL, O_NONBLOCK) < 0)
+		listenerFailure("fcntl");
+	if (bind(_listenFd, (struct sockaddr *)(&serverAddr), sizeof(serverAddr)) < 0)
+		listenerFailure("bind");
+	if (listen(_listenFd, _server.getConfigSize("listen_backlog", SOMAXCONN)) < 0)
+		listenerFailure("listen");
+}
+
+/*
+** Socket reads only touch the client's own input buffer, and only this shard
+** ever reads from or frees its clients, so they are done before taking the
+** server state lock. Bytes a completion backend received are only copied in
+** at dispatch, right before parsing, so several receives for one client in
+** a batch cannot overflow its buffer.
+*/
+void	EventLoop::_readReady(void)
+{
+	_readResults.assign(_ready.size(), 0);
+	for (size_t i = 0; i < _ready.size(); i++)
+	{
+		const IOEvent	&event = _ready[i];
+
+		if (event.data == NULL || (event.events & (POLLHUP | POLLERR | POLLNVAL)))
+			continue ;
+		if (event.events & IO_RECEIVED)
+			_readResults[i] = event.result;
+		else if (event.events & POLLIN)
+			_readResults[i] = _server.getMsgHandler().readInput(*static_cast<Client *>(event.data));
+	}
+}
+
+void	EventLoop::_dispatchReady(void)
+{
+	for (size_t i = 0; i < _ready.size(); i++)
+	{
+		const IOEvent	&event = _ready[i];
+
+		if (event.events & IO_ACCEPTED)
+		{
+			if (event.result < 0)
+				_server.handleAcceptError(-event.result, *this);
+			else
+				_server.admitClient(event.result, *this);
+			continue ;
+		}
+		if (event.fd == _listenFd)
+		{
+			_server.handleNewConnectionRequest(*this);
+			continue ;
+		}
+		if (event.data == NULL)
+		{
+			if (event.fd == _wakeFd)
+			{
+				uint64_t	count;
+				while (read(_wakeFd, &count, sizeof(count)) > 0)
+					;
+			}
+			else if (event.fd == _server.getQuoteBot()->getApiSocketFd())
+				_server.handleApiEvent(event);
+			continue ;
+		}
+		Client	*client = static_cast<Client *>(event.data);
+		if (client->isDisconnected())
+			continue ;
+		if (event.events & (POLLHUP | POLLERR | POLLNVAL))
+		{
+			_server.disconnectClient(client);
+			continue ;
+		}
+		if (event.events & IO_SENT)
+		{
+			if (event.result < 0)
+			{
+				Server::stats.failedWrites++;
+				_server.disconnectClient(client);
+				continue ;
+			}
+			client->getOutgoing().consume(event.result);
+			_countSent(client, event.result);
+			if (!_flushClient(client))
+			{
+				_server.disconnectClient(client);
+				continue ;
+			}
+			_applyInterest(client);
+		}
+		if (event.events & POLLOUT)
+			markDirty(client);
+		if (event.events & (POLLIN | IO_RECEIVED))
+		{
+			if (_readResults[i] <= 0 && _readResults[i] != READ_SKIPPED)
+				_server.disconnectClient(client);
+			else
+			{
+				if (_readResults[i] > 0)
+					Server::stats.bytesRead += _readResults[i];
+				if (event.events & IO_RECEIVED)
+					_server.getMsgHandler().appendInput(*client, event.buffer, event.result);
+				_server.getMsgHandler().processInput(*client);
+			}
+		}
+	}
+}
+
+/*
+** Readable interest is dropped while a client has more than sendq_pause bytes
+** waiting: it stops producing work for us until it reads what it has. The
+** same goes for a client out of flood control tokens, until they refill.
+*/
+void	EventLoop::_applyInterest(Client *client)
+{
+	size_t	queued = client->queuedBytes();
+	short	events = POLLIN;
+
+	if (queued > 0)
+		events |= POLLOUT;
+	if (queued > _sendqPause || client->isThrottled())
+		events &= ~POLLIN;
+	if (events == (client->getSocket().events & (POLLIN | POLLOUT)))
+		return ;
+	client->setEvents(events);
+	_backend->modify(client->getFd(), events, client);
+}
+
+/*
+** Readiness backends write what the socket takes right now; completion
+** backends get one send submitted and report back with IO_SENT. Called with
+** the state lock held.
+*/
+bool	EventLoop::_flushClient(Client *client)
+{
+	SendQueue	&outgoing = client->takeOutput();
+
+	if (_backend->completesIO())
+		return (_backend->send(client->getFd(), outgoing));
+
+	ssize_t	sent = outgoing.flush(client->getFd());
+	if (sent < 0)
+	{
+		Server::stats.failedWrites++;
+		return (false);
+	}
+	_countSent(client, sent);
+	return (true);
+}
+
+/* Output left queued after a send means the socket took less than offered */
+void	EventLoop::_countSent(Client *client, size_t sent)
+{
+	Server::stats.bytesWritten += sent;
+	if (!client->getOutgoing().empty())
+		Server::stats.shortWrites++;
+}
+
+/*
+** Disconnecting a client here can queue QUIT lines for others and grow the
+** list, hence the index loop. A client that went over its SendQ ceiling is
+** dropped rather than written to. A completion backend only gets its sends
+** submitted, which is cheap enough to do here; for a readiness backend the
+** output is moved aside and written by _sendFlushing() without the lock.
+*/
+void	EventLoop::_flushDirty(void)
+{
+	for (size_t i = 0; i < _dirty.size(); i++)
+	{
+		Client	*client = _dirty[i];
+
+		client->setDirty(false);
+		if (client->isDisconnected())
+			continue ;
+		if (client->isSendqExceeded())
+		{
+			LOGF_WARNING("%s exceeded its SendQ of %lu bytes", client->nickname(), client->getSendqLimit());
+			Server::stats.sendqEvictions++;
+			_server.disconnectClient(client, "SendQ exceeded");
+			continue ;
+		}
+		if (!_backend->completesIO())
+		{
+			client->takeOutput();
+			_flushing.push_back(client);
+		}
+		else if (!_flushClient(client))
+			_server.disconnectClient(client);
+		else
+			_applyInterest(client);
+	}
+	_dirty.clear();
+}
+
+/*
+** Runs without the state lock. Only this shard touches its clients' moved
+** output and sockets, and none of them can be freed before the next
+** _reapDisconnected(). Counts and failures wait for _settleFlushing().
+*/
+void	EventLoop::_sendFlushing(void)
+{
+	for (size_t i = 0; i < _flushing.size(); i++)
+	{
+		Client		*client = _flushing[i];
+		SendQueue	&outgoing = client->getOutgoing();
+		ssize_t		sent = outgoing.send(client->getFd());
+
+		if (sent < 0)
+		{
+			_failed.push_back(client);
+			continue ;
+		}
+		_written += sent;
+		if (!outgoing.empty())
+			_shortWrites++;
+		_applyInterest(client);
+	}
+}
+
+/*
+** Dropping a client whose send failed queues its QUIT for the others, some
+** of them this shard's, so the caller collects dirty clients again after.
+*/
+void	EventLoop::_settleFlushing(void)
+{
+	for (size_t i = 0; i < _flushing.size(); i++)
+		_flushing[i]->getOutgoing().settle();
+	_flushing.clear();
+	Server::stats.bytesWritten += _written;
+	Server::stats.shortWrites += _shortWrites;
+	_written = 0;
+	_shortWrites = 0;
+	for (size_t i = 0; i < _failed.size(); i++)
+	{
+		Server::stats.failedWrites++;
+		_server.disconnectClient(_failed[i]);
+	}
+	_failed.clear();
+}
+
+/*
+** Throttled clients whose tokens refilled get their buffered lines handled,
+** then are read from again unless those lines emptied the buckets anew. The
+** list is only walked once the earliest of them is due; _resumeAt may be
+** early, after that client left, never late.
+*/
+void	EventLoop::_resumeThrottled(void)
+{
+	uint64_t	now = monotonicNs();
+	size_t		i = 0;
+
+	if (_throttled.empty() || now < _resumeAt)
+		return ;
+	_resumeAt = (uint64_t)-1;
+	while (i < _throttled.size())
+	{
+		Client	*client = _throttled[i];
+
+		if (client->isDisconnected())
+		{
+			_unthrottle(client);
+			continue ;
+		}
+		if (!client->hasTokens(now))
+		{
+			_resumeAt = std::min(_resumeAt, now + client->tokenDelay());
+			i++;
+			continue ;
+		}
+		_unthrottle(client);
+		_server.getMsgHandler().processInput(*client);
+		if (!client->isDisconnected())
+			_applyInterest(client);
+	}
+}
+
+/* Moves the last throttled client into the gap, like Client::dropMembership */
+void	EventLoop::_unthrottle(Client *client)
+{
+	Client	*last = _throttled.back();
+
+	_throttled[client->getThrottledPos()] = last;
+	last->setThrottledPos(client->getThrottledPos());
+	_throttled.pop_back();
+	client->setThrottled(false);
+}
+
+/* Blocks until an event, or until the first throttled client can go on */
+int	EventLoop::_waitTimeout(void) const
+{
+	uint64_t	now = monotonicNs();
+	uint64_t	delay = _resumeAt > now ? _resumeAt - now : 0;
+
+	if (_throttled.empty())
+		return (-1);
+	return (static_cast<int>(std::min(delay / 1000000 + 1, (uint64_t)1000)));
+}
+
+void	EventLoop::_closeReleased(void)
+{
+	for (size_t i = 0; i < _closing.size(); i++)
+	{
+		_flushClient(_closing[i]);
+		_backend->remove(_closing[i]->getFd());
+		close(_closing[i]->getFd());
+		_disconnected.push_back(_closing[i]);
+	}
+	_closing.clear();
+}
+
+void	EventLoop::_watchPending(void)
+{
+	for (size_t i = 0; i < _pendingFds.size(); i++)
+		_backend->add(_pendingFds[i].fd, _pendingFds[i].events, NULL);
+	_pendingFds.clear();
+}
+
+void	EventLoop::_reapDisconnected(void)
+{
+	for (size_t i = 0; i < _disconnected.size(); i++)
+	{
+		if (_disconnected[i]->isThrottled())
+			_unthrottle(_disconnected[i]);
+		delete _disconnected[i];
+	}
+	_disconnected.clear();
+}
+
+void	*EventLoop::_threadMain(void *loop)
+{
+	static_cast<EventLoop *>(loop)->run();
+	return (NULL);
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+void	EventLoop::watch(Client *client)
+{
+	client->setLoop(this);
+	_backend->add(client->getFd(), client->getSocket().events, client);
+}
+
+/*
+** Registers a server-owned socket. Backends are only driven by the owning
+** thread, so a request from another shard waits for the next iteration.
+*/
+void	EventLoop::watchFd(int fd, short events)
+{
+	if (isCurrentThread())
+	{
+		_backend->add(fd, events, NULL);
+		return ;
+	}
+	pollfd	pfd = {fd, events, 0};
+	_pendingFds.push_back(pfd);
+	wake();
+}
+
+/*
+** Called with the state lock held, from any shard. The owner closes the
+** socket right away; another shard hands the client over and wakes it up.
+** Either way the Client is only deleted at the end of the owner's iteration,
+** since events already collected for it may still point at it.
+*/
+void	EventLoop::release(Client *client)
+{
+	if (isCurrentThread())
+	{
+		_flushClient(client);
+		_backend->remove(client->getFd());
+		close(client->getFd());
+		_disconnected.push_back(client);
+		return ;
+	}
+	_closing.push_back(client);
+	wake();
+}
+
+/*
+** Called with the state lock held once output was queued for one of this
+** loop's clients. Only the owner writes to its sockets, so another shard
+** queueing for it has to wake it up.
+*/
+void	EventLoop::markDirty(Client *client)
+{
+	if (client->isDirty())
+		return ;
+	client->setDirty(true);
+	_dirty.push_back(client);
+	if (!isCurrentThread())
+		wake();
+}
+
+/*
+** Called by MsgHandler, on the owner's thread, when a client ran out of flood
+** control tokens with input left to handle.
+*/
+void	EventLoop::throttle(Client *client)
+{
+	uint64_t	resumeAt = monotonicNs() + client->tokenDelay();
+
+	if (client->isThrottled())
+		return ;
+	if (_throttled.empty() || resumeAt < _resumeAt)
+		_resumeAt = resumeAt;
+	client->setThrottled(true);
+	client->setThrottledPos(_throttled.size());
+	_throttled.push_back(client);
+	_applyInterest(client);
+}
+
+/*
+** EAGAIN means the counter is already nonzero, so the loop wakes anyway. Any
+** other failure leaves it asleep with work pending until its next event.
+*/
+void	EventLoop::wake(void)
+{
+	uint64_t	one = 1;
+
+	if (_wakeFd >= 0 && write(_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		LOGF_WARNING("Event loop %lu wakeup failed: %s", _id, strerror(errno));
+}
+
+void	EventLoop::run(void)
+{
+	_server.lock();
+	_thread = pthread_self();
+	_server.unlock();
+	while (_server.isRunning())
+	{
+		if (_backend->wait(_ready, _waitTimeout()) < 0)
+			continue ;
+		Logger::tick();
+		_readReady();
+		_server.lock();
+		_dispatchReady();
+		_resumeThrottled();
+		_flushDirty();
+		while (!_flushing.empty())
+		{
+			_server.unlock();
+			_sendFlushing();
+			_server.lock();
+			_settleFlushing();
+			_flushDirty();
+		}
+		_closeReleased();
+		_watchPending();
+		_reapDisconnected();
+		_server.unlock();
+	}
+}
+
+/*
+** Called once the loops stopped, with output still queued (the shutdown
+** notice). Sends submitted to a completion backend are waited for here, so
+** nothing is still in flight when the sockets get closed.
+*/
+void	EventLoop::drain(void)
+{
+	_flushDirty();
+	while (!_flushing.empty())
+	{
+		_sendFlushing();
+		_settleFlushing();
+		_flushDirty();
+	}
+	for (int tries = 0; tries < 20 && _backend->pendingSends() > 0; tries++)
+	{
+		_backend->wait(_ready, 50);
+		for (size_t i = 0; i < _ready.size(); i++)
+		{
+			Client	*client = static_cast<Client *>(_ready[i].data);
+			if (!(_ready[i].events & IO_SENT) || client == NULL || _ready[i].result <= 0)
+				continue ;
+			client->getOutgoing().consume(_ready[i].result);
+			_countSent(client, _ready[i].result);
+			_flushClient(client);
+		}
+	}
+}
+
+void	EventLoop::start(void)
+{
+	if (pthread_create(&_handle, NULL, &EventLoop::_threadMain, this) != 0)
+		error("Failed to start event loop " + sizeToString(_id));
+}
+
+void	EventLoop::join(void) { pthread_join(_handle, NULL); }
@@ -0,0 +1,80 @@
+#include "../include/Histogram.hpp"
+#include <cstring>
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+Histogram::Histogram(void) : _total(0), _max(0)
+{
+	std::memset(_counts, 0, sizeof(_counts));
+}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+uint64_t	Histogram::count(void) const { return (_total); }
+
+uint64_t	Histogram::max(void) const { return (_max); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/*
+** Values below 16 get a bucket each. Above, the bucket is the position of
+** the highest set bit and the 4 bits right after it.
+*/
+size_t	Histogram::_bucket(uint64_t value)
+{
+	if (value < HISTOGRAM_SUB)
+		return (value);
+	int	high = 63 - __builtin_clzll(value);
+	int	shift = high - HISTOGRAM_SUB_BITS;
+	return ((shift + 1) * HISTOGRAM_SUB + ((value >> shift) & (HISTOGRAM_SUB - 1)));
+}
+
+/* Largest value that lands in `bucket` */
+uint64_t	Histogram::_upperBound(size_t bucket)
+{
+	if (bucket < HISTOGRAM_SUB)
+		return (bucket);
+	int			shift = bucket / HISTOGRAM_SUB - 1;
+	uint64_t	lower = static_cast<uint64_t>(HISTOGRAM_SUB + bucket % HISTOGRAM_SUB) << shift;
+	return (lower + ((static_cast<uint64_t>(1) << shift) - 1));
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+void	Histogram::record(uint64_t value)
+{
+	_counts[_bucket(value)]++;
+	_total++;
+	if (value > _max)
+		_max = value;
+}
+
+/*
+** Smallest bucket bound with at least `quantile` of the values at or below
+** it, capped by the largest value seen. 0 when nothing was recorded.
+*/
+uint64_t	Histogram::percentile(double quantile) const
+{
+	uint64_t	rank = static_cast<uint64_t>(quantile * _total + 0.999999);
+	uint64_t	seen = 0;
+
+	if (_total == 0)
+		return (0);
+	if (rank < 1)
+		rank = 1;
+	for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += _counts[i];
+		if (seen >= rank)
+			return (_upperBound(i) < _max ? _upperBound(i) : _max);
+	}
+	return (_max);
+}
@@ -0,0 +1,146 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+InputBuffer::InputBuffer(size_t capacity)
+	: _data(_allocate(capacity)), _capacity(capacity), _start(0), _end(0),
+	  _scanned(0), _discarding(false), _discardedCr(false) {}
+
+InputBuffer::~InputBuffer(void)
+{
+	if (_capacity == _blocks(_capacity).blockSize())
+		_blocks(_capacity).release(_data);
+	else
+		delete[] _data;
+}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+size_t	InputBuffer::size(void) const { return (_end - _start); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/*
+** recv_buffer_size is fixed for the life of the server, so the first buffer
+** sizes the pool; a block of any other size comes from the heap.
+*/
+SlabPool	&InputBuffer::_blocks(size_t capacity)
+{
+	static SlabPool	pool("InputBuffer", capacity, 16);
+	return (pool);
+}
+
+char	*InputBuffer::_allocate(size_t capacity)
+{
+	if (capacity == _blocks(capacity).blockSize())
+		return (static_cast<char *>(_blocks(capacity).allocate()));
+	return (new char[capacity]);
+}
+
+void	InputBuffer::_compact(void)
+{
+	std::memmove(_data, _data + _start, _end - _start);
+	_end -= _start;
+	_start = 0;
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/*
+** Room left after the received bytes. A block filled by a single unfinished
+** line can never frame it: that line is dropped, up to its CRLF. A block
+** still holding complete lines reports no room until they are parsed. If the
+** dropped block ended in CR, an LF arriving next ends the dropped line.
+*/
+char	*InputBuffer::reserve(size_t &room)
+{
+	if (_end == _capacity && _start > 0)
+		_compact();
+	if (_end == _capacity && _scanned == _end - _start)
+	{
+		_discardedCr = _data[_end - 1] == '\r';
+		_start = _end = _scanned = 0;
+		_discarding = true;
+	}
+	room = _capacity - _end;
+	return (_data + _end);
+}
+
+void	InputBuffer::commit(size_t length) { _end += length; }
+
+size_t	InputBuffer::append(const char *data, size_t length)
+{
+	size_t	taken = 0;
+
+	while (taken < length)
+	{
+		size_t	room;
+		char	*space = reserve(room);
+		if (room == 0)
+			break ;
+		size_t	chunk = std::min(room, length - taken);
+		std::memcpy(space, data + taken, chunk);
+		commit(chunk);
+		taken += chunk;
+	}
+	return (taken);
+}
+
+/*
+** Frames the next CRLF-terminated line, without the CRLF. Bytes already
+** searched are not searched again when more input arrives.
+*/
+bool	InputBuffer::nextLine(StringView &line)
+{
+	while (true)
+	{
+		const char	*begin = _data + _start;
+		size_t		pending = _end - _start;
+		size_t		from = _scanned;
+		const char	*lf = NULL;
+
+		if (_discardedCr && pending > 0)
+		{
+			_discardedCr = false;
+			if (begin[0] == '\n')
+			{
+				_start++;
+				_scanned = 0;
+				_discarding = false;
+				continue ;
+			}
+		}
+		while (from < pending)
+		{
+			lf = static_cast<const char *>(std::memchr(begin + from, '\n', pending - from));
+			if (lf == NULL || (lf > begin && lf[-1] == '\r'))
+				break ;
+			from = (lf - begin) + 1;
+			lf = NULL;
+		}
+		if (lf == NULL)
+		{
+			_scanned = pending;
+			if (_start == _end)
+				_start = _end = _scanned = 0;
+			return (false);
+		}
+		_start += (lf - begin) + 1;
+		_scanned = 0;
+		if (_discarding)
+		{
+			_discarding = false;
+			continue ;
+		}
+		line = StringView(begin, (lf - begin) - 1);
+		return (true);
+	}
+}
@@ -0,0 +1,537 @@
+#include "../include/irc.hpp"
+#include "../include/IoUringBackend.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Submission kinds, kept in the low bits of user_data */
+enum { OP_SEND = 0, OP_ACCEPT = 1, OP_RECV = 2, OP_POLL = 3, OP_CANCEL = 4 };
+
+#define URING_ENTRIES	256
+#define URING_CQ_ENTRIES	4096
+#define BUFFER_GROUP	0
+
+struct	KernelTimespec
+{
+	int64_t		tv_sec;
+	long long	tv_nsec;
+};
+
+static int	ioUringSetup(unsigned entries, io_uring_params *params)
+{
+	return (syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int	ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+	return (syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static int	ioUringRegister(int fd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+	return (syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+IoUringBackend::IoUringBackend(unsigned bufferCount, unsigned bufferSize)
+	: _ringFd(-1), _sqRing(MAP_FAILED), _cqRing(MAP_FAILED), _sqes((io_uring_sqe *)MAP_FAILED),
+	  _pending(0), _extArg(false), _bufRing((io_uring_buf *)MAP_FAILED),
+	  _bufBase((char *)MAP_FAILED), _bufCount(0), _bufSize(0), _bufTail(0), _listenFd(-1),
+	  _inflightSends(0)
+{
+	if (!_setupRing(URING_ENTRIES))
+		return ;
+	if (!_setupBuffers(bufferCount, bufferSize))
+	{
+		close(_ringFd);
+		_ringFd = -1;
+	}
+}
+
+IoUringBackend::~IoUringBackend(void)
+{
+	if (_ringFd >= 0)
+		close(_ringFd);
+	_releaseRetired();
+	if (_sqes != MAP_FAILED)
+		munmap(_sqes, _sqesSize);
+	if (_cqRing != MAP_FAILED && _cqRing != _sqRing)
+		munmap(_cqRing, _cqRingSize);
+	if (_sqRing != MAP_FAILED)
+		munmap(_sqRing, _sqRingSize);
+	if (_bufRing != MAP_FAILED)
+		munmap(_bufRing, _bufRingSize);
+	if (_bufBase != MAP_FAILED)
+		munmap(_bufBase, (size_t)_bufCount * _bufSize);
+}
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+bool	IoUringBackend::_setupRing(unsigned entries)
+{
+	io_uring_params	params;
+
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = URING_CQ_ENTRIES;
+	_ringFd = ioUringSetup(entries, &params);
+	if (_ringFd < 0)
+		return (warning("io_uring_setup failed: " + std::string(strerror(errno))), false);
+
+	_sqEntries = params.sq_entries;
+	_extArg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+	_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		_sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+	_sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+	if (_sqRing == MAP_FAILED)
+		return (false);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		_cqRing = _sqRing;
+	else
+		_cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+	_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	_sqes = (io_uring_sqe *)mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+	if (_cqRing == MAP_FAILED || _sqes == MAP_FAILED)
+		return (false);
+
+	char	*sq = static_cast<char *>(_sqRing);
+	char	*cq = static_cast<char *>(_cqRing);
+	_sqHead = (unsigned *)(sq + params.sq_off.head);
+	_sqTail = (unsigned *)(sq + params.sq_off.tail);
+	_sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+	_sqArray = (unsigned *)(sq + params.sq_off.array);
+	_cqHead = (unsigned *)(cq + params.cq_off.head);
+	_cqTail = (unsigned *)(cq + params.cq_off.tail);
+	_cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+	_cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+	return (true);
+}
+
+/*
+** Receive buffers are handed to the kernel through a registered buffer ring;
+** a multishot recv picks one per completion and we give it back once the
+** bytes have been copied into the client's input buffer.
+**
+** The ring is addressed as a plain io_uring_buf array: the flexible array in
+** io_uring_buf_ring does not get the C layout when compiled as C++98.
+** The ring tail overlays the first entry's resv field.
+*/
+bool	IoUringBackend::_setupBuffers(unsigned count, unsigned size)
+{
+	unsigned	ringEntries = 1;
+
+	while (ringEntries < count && ringEntries < 32768)
+		ringEntries <<= 1;
+	_bufCount = ringEntries;
+	_bufSize = size;
+	_bufRingSize = _bufCount * sizeof(io_uring_buf);
+	_bufRing = (io_uring_buf *)mmap(NULL, _bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	_bufBase = (char *)mmap(NULL, (size_t)_bufCount * _bufSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (_bufRing == MAP_FAILED || _bufBase == MAP_FAILED)
+		return (false);
+
+	io_uring_buf_reg	reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)_bufRing;
+	reg.ring_entries = _bufCount;
+	reg.bgid = BUFFER_GROUP;
+	if (ioUringRegister(_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		return (warning("io_uring buffer ring unavailable: " + std::string(strerror(errno))), false);
+
+	for (unsigned bid = 0; bid < _bufCount; bid++)
+		_recycleBuffer(bid);
+	_publishBuffers();
+	return (true);
+}
+
+io_uring_sqe	*IoUringBackend::_getSqe(void)
+{
+	unsigned	tail = *_sqTail + _pending;
+
+	if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+	{
+		_submit(0, 0);
+		tail = *_sqTail;
+		if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+			return (NULL);
+	}
+	unsigned		index = tail & *_sqMask;
+	io_uring_sqe	*sqe = &_sqes[index];
+	_sqArray[index] = index;
+	_pending++;
+	memset(sqe, 0, sizeof(*sqe));
+	return (sqe);
+}
+
+int	IoUringBackend::_submit(unsigned waitFor, int timeout)
+{
+	if (_pending > 0)
+	{
+		__atomic_store_n(_sqTail, *_sqTail + _pending, __ATOMIC_RELEASE);
+		_pending = 0;
+	}
+	unsigned	toSubmit = *_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+	unsigned	flags = waitFor ? IORING_ENTER_GETEVENTS : 0;
+
+	if (waitFor && timeout >= 0 && _extArg)
+	{
+		KernelTimespec			ts;
+		io_uring_getevents_arg	arg;
+
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+		memset(&arg, 0, sizeof(arg));
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+		return (ioUringEnter(_ringFd, toSubmit, waitFor, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+	}
+	if (waitFor && timeout >= 0)
+		flags = 0;
+	if (toSubmit == 0 && flags == 0)
+		return (0);
+	return (ioUringEnter(_ringFd, toSubmit, flags ? waitFor : 0, flags, NULL, 0));
+}
+
+void	IoUringBackend::_recycleBuffer(unsigned short bid)
+{
+	io_uring_buf	*buf = &_bufRing[_bufTail & (_bufCount - 1)];
+
+	buf->addr = (uint64_t)(uintptr_t)(_bufBase + (size_t)bid * _bufSize);
+	buf->len = _bufSize;
+	buf->bid = bid;
+	_bufTail++;
+}
+
+void	IoUringBackend::_publishBuffers(void)
+{
+	__atomic_store_n(&_bufRing[0].resv, _bufTail, __ATOMIC_RELEASE);
+}
+
+IoUringBackend::Slot	&IoUringBackend::_slot(int fd)
+{
+	if ((size_t)fd >= _slots.size())
+		_slots.resize(fd + 1);
+	return (_slots[fd]);
+}
+
+uint64_t	IoUringBackend::_tag(int type, int fd) const
+{
+	return (((uint64_t)_slots[fd].generation << 32) | ((uint64_t)fd << 3) | type);
+}
+
+void	IoUringBackend::_armAccept(int fd)
+{
+	io_uring_sqe	*sqe = _getSqe();
+
+	if (!sqe)
+		return error("io_uring: no submission slot for accept");
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	sqe->user_data = _tag(OP_ACCEPT, fd);
+}
+
+void	IoUringBackend::_armRecv(int fd)
+{
+	io_uring_sqe	*sqe = _getSqe();
+
+	if (!sqe)
+		return error("io_uring: no submission slot for recv");
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUFFER_GROUP;
+	sqe->user_data = _tag(OP_RECV, fd);
+	_slots[fd].recvArmed = true;
+}
+
+void	IoUringBackend::_armPoll(int fd)
+{
+	io_uring_sqe	*sqe = _getSqe();
+
+	if (!sqe)
+		return error("io_uring: no submission slot for poll");
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = _slots[fd].events;
+	sqe->user_data = _tag(OP_POLL, fd);
+}
+
+void	IoUringBackend::_cancel(uint64_t userData)
+{
+	io_uring_sqe	*sqe = _getSqe();
+
+	if (!sqe)
+		return error("io_uring: no submission slot for cancel");
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = userData;
+	sqe->user_data = OP_CANCEL;
+}
+
+/*
+** Runs outside the server state lock, so the SharedBuffer references a send
+** held are not dropped here but on the next locked call (see send()).
+*/
+void	IoUringBackend::_completeSend(SendOp *op, int res, std::vector<IOEvent> &ready)
+{
+	_inflightSends--;
+	_retired.push_back(op);
+	if ((size_t)op->fd >= _slots.size())
+		return ;
+	Slot	&slot = _slots[op->fd];
+	if (!slot.registered || slot.generation != op->generation)
+		return ;
+	slot.sending = false;
+
+	IOEvent	event;
+	event.fd = op->fd;
+	event.events = IO_SENT;
+	event.data = slot.data;
+	event.result = res;
+	event.buffer = NULL;
+	ready.push_back(event);
+}
+
+void	IoUringBackend::_complete(const io_uring_cqe &cqe, std::vector<IOEvent> &ready)
+{
+	int			type = cqe.user_data & 7;
+	if (type == OP_SEND)
+		return _completeSend((SendOp *)(uintptr_t)cqe.user_data, cqe.res, ready);
+	if (type == OP_CANCEL)
+		return ;
+
+	int			fd = (cqe.user_data >> 3) & 0x1FFFFFFF;
+	uint32_t	generation = cqe.user_data >> 32;
+	bool		more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+	bool		current = (size_t)fd < _slots.size() && _slots[fd].registered && _slots[fd].generation == generation;
+	bool		hasBuffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+	unsigned short	bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+	IOEvent	event;
+	event.fd = fd;
+	event.data = current ? _slots[fd].data : NULL;
+	event.result = cqe.res;
+	event.buffer = NULL;
+
+	if (type == OP_ACCEPT)
+	{
+		event.events = IO_ACCEPTED;
+		ready.push_back(event);
+		if (more || !current)
+			return ;
+		if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+			_armPoll(fd);
+		else
+			_armAccept(fd);
+	}
+	else if (type == OP_RECV)
+	{
+		if (!current)
+		{
+			if (hasBuffer)
+				_recycleBuffer(bid);
+			return ;
+		}
+		Slot	&slot = _slots[fd];
+		if (!more)
+			slot.recvArmed = false;
+		if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED)
+		{
+			if (hasBuffer)
+				_recycleBuffer(bid);
+			if (!more && (slot.events & POLLIN))
+				_armRecv(fd);
+			return ;
+		}
+		event.events = IO_RECEIVED;
+		if (hasBuffer)
+		{
+			event.buffer = _bufBase + (size_t)bid * _bufSize;
+			_usedBuffers.push_back(bid);
+		}
+		ready.push_back(event);
+		if (!more && cqe.res > 0 && (slot.events & POLLIN))
+			_armRecv(fd);
+	}
+	else if (type == OP_POLL && current)
+	{
+		event.events = (cqe.res < 0) ? POLLERR : (short)cqe.res;
+		ready.push_back(event);
+		if (fd == _listenFd)
+			_armAccept(fd);
+		else
+			_armPoll(fd);
+	}
+}
+
+void	IoUringBackend::_releaseRetired(void)
+{
+	for (size_t i = 0; i < _retired.size(); i++)
+	{
+		for (size_t j = 0; j < _retired[i]->count; j++)
+			_retired[i]->refs[j]->release();
+		delete _retired[i];
+	}
+	_retired.clear();
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+bool	IoUringBackend::isOpen(void) const { return (_ringFd >= 0); }
+
+const char	*IoUringBackend::name(void) const { return "io_uring"; }
+
+bool	IoUringBackend::completesIO(void) const { return (true); }
+
+size_t	IoUringBackend::pendingSends(void) const { return (_inflightSends); }
+
+bool	IoUringBackend::add(int fd, short events, void *data)
+{
+	Slot	&slot = _slot(fd);
+
+	slot.generation++;
+	slot.registered = true;
+	slot.data = data;
+	slot.events = events & (POLLIN | POLLOUT);
+	slot.isClient = (data != NULL);
+	slot.recvArmed = false;
+	slot.sending = false;
+	if (!slot.isClient)
+		_armPoll(fd);
+	else if (slot.events & POLLIN)
+		_armRecv(fd);
+	return (true);
+}
+
+bool	IoUringBackend::listen(int fd)
+{
+	Slot	&slot = _slot(fd);
+
+	slot.generation++;
+	slot.registered = true;
+	slot.data = NULL;
+	slot.events = POLLIN;
+	slot.isClient = false;
+	_listenFd = fd;
+	_armAccept(fd);
+	return (true);
+}
+
+/*
+** For clients only POLLIN matters: dropping it cancels the multishot recv,
+** restoring it re-arms one. Sends are explicit, so POLLOUT is ignored.
+*/
+bool	IoUringBackend::modify(int fd, short events, void *data)
+{
+	if ((size_t)fd >= _slots.size() || !_slots[fd].registered)
+		return (false);
+	Slot	&slot = _slots[fd];
+
+	slot.data = data;
+	slot.events = events & (POLLIN | POLLOUT);
+	if (!slot.isClient)
+		return (true);
+	if ((slot.events & POLLIN) && !slot.recvArmed)
+		_armRecv(fd);
+	else if (!(slot.events & POLLIN) && slot.recvArmed)
+		_cancel(_tag(OP_RECV, fd));
+	return (true);
+}
+
+/*
+** Pending submissions are pushed to the kernel before returning, so none of
+** them can resolve the fd number after the caller closed it.
+*/
+void	IoUringBackend::remove(int fd)
+{
+	if ((size_t)fd >= _slots.size() || !_slots[fd].registered)
+		return ;
+	Slot	&slot = _slots[fd];
+
+	if (slot.isClient && slot.recvArmed)
+		_cancel(_tag(OP_RECV, fd));
+	else if (!slot.isClient)
+		_cancel(_tag(OP_POLL, fd));
+	slot.registered = false;
+	slot.generation++;
+	_releaseRetired();
+	_submit(0, 0);
+}
+
+int	IoUringBackend::wait(std::vector<IOEvent> &ready, int timeout)
+{
+	ready.clear();
+	for (size_t i = 0; i < _usedBuffers.size(); i++)
+		_recycleBuffer(_usedBuffers[i]);
+	_usedBuffers.clear();
+	_publishBuffers();
+
+	if (*_cqHead == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+	{
+		if (_submit(1, timeout) < 0 && errno != EINTR && errno != ETIME && errno != EBUSY)
+			warning("io_uring_enter failed: " + std::string(strerror(errno)));
+	}
+	else
+		_submit(0, 0);
+
+	unsigned	head = *_cqHead;
+	unsigned	tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+	while (head != tail)
+	{
+		io_uring_cqe	cqe = _cqes[head & *_cqMask];
+		__atomic_store_n(_cqHead, ++head, __ATOMIC_RELEASE);
+		_complete(cqe, ready);
+		tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+	}
+	return (ready.size());
+}
+
+/*
+** One SENDMSG in flight per client, gathering up to SENDQ_IOV_MAX queued
+** chunks. The op keeps its own references on the buffers, so the bytes stay
+** valid for the kernel even if the client is gone before it completes.
+*/
+bool	IoUringBackend::send(int fd, SendQueue &queue)
+{
+	_releaseRetired();
+	if ((size_t)fd >= _slots.size() || !_slots[fd].registered)
+		return (false);
+	Slot	&slot = _slots[fd];
+	if (slot.sending || queue.empty())
+		return (true);
+
+	io_uring_sqe	*sqe = _getSqe();
+	if (!sqe)
+		return (false);
+
+	SendOp	*op = new SendOp;
+	op->fd = fd;
+	op->generation = slot.generation;
+	op->count = queue.gather(op->iov, op->refs, SENDQ_IOV_MAX);
+	for (size_t i = 0; i < op->count; i++)
+		op->refs[i]->retain();
+	memset(&op->msg, 0, sizeof(op->msg));
+	op->msg.msg_iov = op->iov;
+	op->msg.msg_iovlen = op->count;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)&op->msg;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = (uint64_t)(uintptr_t)op;
+	slot.sending = true;
+	_inflightSends++;
+	return (true);
+}
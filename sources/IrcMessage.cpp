@@ -0,0 +1,79 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+IrcMessage::IrcMessage(void) : _paramCount(0) {}
+
+IrcMessage::~IrcMessage(void) {}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+const StringView	&IrcMessage::prefix(void) const { return (_prefix); }
+
+const StringView	&IrcMessage::command(void) const { return (_command); }
+
+size_t	IrcMessage::paramCount(void) const { return (_paramCount); }
+
+/* An absent param reads as empty */
+StringView	IrcMessage::param(size_t i) const
+{
+	if (i >= _paramCount)
+		return (StringView());
+	return (_params[i]);
+}
+
+std::string	IrcMessage::arg(size_t i) const { return (param(i).str()); }
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/*
+** Returns false for a line without a command (empty, or only a prefix).
+*/
+bool	IrcMessage::parse(const StringView &line)
+{
+	const char	*p = line.data;
+	const char	*end = line.data + line.size;
+	const char	*start;
+
+	_prefix = StringView();
+	_paramCount = 0;
+	if (p < end && *p == ':')
+	{
+		start = ++p;
+		while (p < end && *p != ' ')
+			p++;
+		_prefix = StringView(start, p - start);
+	}
+	while (p < end && *p == ' ')
+		p++;
+	start = p;
+	while (p < end && *p != ' ')
+		p++;
+	_command = StringView(start, p - start);
+
+	while (_paramCount < IRC_MAX_PARAMS)
+	{
+		while (p < end && *p == ' ')
+			p++;
+		if (p == end)
+			break ;
+		if (*p == ':' || _paramCount == IRC_MAX_PARAMS - 1)
+		{
+			if (*p == ':')
+				p++;
+			_params[_paramCount++] = StringView(p, end - p);
+			break ;
+		}
+		start = p;
+		while (p < end && *p != ' ')
+			p++;
+		_params[_paramCount++] = StringView(start, p - start);
+	}
+	return (!_command.empty());
+}
@@ -0,0 +1,112 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+SlabPool	&Membership::pool(void)
+{
+	static SlabPool	pool("Membership", sizeof(Membership), 256);
+	return (pool);
+}
+
+void	*Membership::operator new(size_t size)
+{
+	(void)size;
+	return (pool().allocate());
+}
+
+void	Membership::operator delete(void *block) { pool().release(block); }
+
+MemberTable::MemberTable(void) : _index(8, NULL) {}
+
+MemberTable::~MemberTable(void) {}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+size_t	MemberTable::size(void) const { return (_members.size()); }
+
+bool	MemberTable::empty(void) const { return (_members.empty()); }
+
+Membership	*MemberTable::operator[](size_t i) const { return (_members[i]); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/*
+** Fibonacci hashing: the top bits of the address times 2^64 / phi. The low
+** bits of such a product only depend on the low bits of the address, and
+** slab-allocated Clients sit at a fixed stride, so those would cluster.
+*/
+size_t	MemberTable::_home(const Client *client) const
+{
+	uint64_t	key = reinterpret_cast<uintptr_t>(client);
+	int			bits = __builtin_ctzll(_index.size());
+
+	return (static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits)));
+}
+
+/* Slot holding the client, or the free slot that ends its probe run */
+size_t	MemberTable::_probe(const Client *client) const
+{
+	size_t	i = _home(client);
+
+	while (_index[i] && _index[i]->client != client)
+		i = (i + 1) & (_index.size() - 1);
+	return (i);
+}
+
+void	MemberTable::_grow(void)
+{
+	std::vector<Membership *>(_index.size() * 2, NULL).swap(_index);
+	for (size_t i = 0; i < _members.size(); i++)
+		_index[_probe(_members[i]->client)] = _members[i];
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+Membership	*MemberTable::find(const Client *client) const { return (_index[_probe(client)]); }
+
+/* False, and nothing stored, when the client already has a member */
+bool	MemberTable::insert(Membership *member)
+{
+	if ((_members.size() + 1) * 4 > _index.size() * 3)
+		_grow();
+	size_t	slot = _probe(member->client);
+	if (_index[slot])
+		return (false);
+	_index[slot] = member;
+	member->memberPos = _members.size();
+	_members.push_back(member);
+	return (true);
+}
+
+void	MemberTable::erase(Membership *member)
+{
+	size_t	i = _probe(member->client);
+	if (_index[i] != member)
+		return ;
+
+	size_t	mask = _index.size() - 1;
+	size_t	j = i;
+	while (_index[j = (j + 1) & mask])
+	{
+		size_t	home = _home(_index[j]->client);
+		bool	stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+		if (stays)
+			continue ;
+		_index[i] = _index[j];
+		i = j;
+	}
+	_index[i] = NULL;
+
+	Membership	*last = _members.back();
+	_members[member->memberPos] = last;
+	last->memberPos = member->memberPos;
+	_members.pop_back();
+}
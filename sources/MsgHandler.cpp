@@ -14,168 +14,245 @@ MsgHandler::~MsgHandler() {};
 // ************************************************************************** //
 
 
-void MsgHandler::handleMODE(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handleMODE(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for MODE command");
-	}
+	std::string channelName = msg.arg(0);
 	// silently ignore user modes
-	if (_server.getClientByNick(msgData[1]))
+	if (_server.getClientByNick(channelName))
 		return ;
 
-	std::string channelName = msgData[1];
 	Channel* chan = _manager.getChanByName(channelName);
 	if (!chan) {
-		sendMSG(client.getFd(), ERR_NOSUCHCHANNEL(client, channelName));
-		return warning("Channel " + channelName + " does not exist");
+		sendMSG(client, ERR_NOSUCHCHANNEL(client, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
 	}
 	if (chan->isClientChanOp(&client) || client.isIRCOp())
-		_manager.setChanMode(msgData, client);
+		_manager.setChanMode(msg, client);
 	else
 	{
-		sendMSG(client.getFd(), ERR_CHANOPPROVSNEEDED(client, channelName));
-		sendMSG(client.getFd(), STD_PREFIX(client) + SERVER_NAME + " " + client.nickname() + " NOTICE :You are not a channel operator\r\n");
-		return warning(client.nickname() + " is not an operator in channel " + channelName);
+		sendMSG(client, ERR_CHANOPPROVSNEEDED(client, channelName));
+		sendMSG(client, NOTICE(client.nickname(), "You are not a channel operator"));
+		return LOGF_WARNING("%s is not an operator in channel %s", client.nickname(), channelName);
 	}
 }
 
-void MsgHandler::handleTOPIC(std::string &msg, Client &client)
+/*
+** Without a new topic, TOPIC only asks for the current one.
+*/
+void MsgHandler::handleTOPIC(const IrcMessage &msg, Client &client)
 {
-	std::string topic = split(msg, ':').back();
-	std::string channelName = split(msg, ' ').at(1);
+	std::string channelName = msg.arg(0);
 	Channel* channel = _manager.getChanByName(channelName);
 
 	if (!channel) {
-		sendMSG(client.getFd(), ERR_NOSUCHCHANNEL(client, channelName));
-		return warning("Channel " + channelName + " does not exist");
+		sendMSG(client, ERR_NOSUCHCHANNEL(client, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
 	}
 	if (!channel->hasClient(&client))
 	{
-		sendMSG(client.getFd(), ERR_NOTONCHANNEL(client, channelName));
-		return warning(client.nickname() + " is not an operator in channel " + channelName);
+		sendMSG(client, ERR_NOTONCHANNEL(client, channelName));
+		return LOGF_WARNING("%s is not an operator in channel %s", client.nickname(), channelName);
+	}
+	if (msg.paramCount() < 2)
+	{
+		if (channel->getTopic().empty())
+			return sendMSG(client, RPL_NOTOPIC(client, channelName));
+		return sendMSG(client, RPL_TOPIC(client, channelName, channel->getTopic()));
 	}
 	if (channel->isTopicRestricted() && !(channel->isClientChanOp(&client) || client.isIRCOp()))
 	{
-		sendMSG(client.getFd(), ERR_CHANOPPROVSNEEDED(client, channelName));
-		sendMSG(client.getFd(), STD_PREFIX(client) + SERVER_NAME + " " + client.nickname() + " NOTICE :You are not a channel operator\r\n");
-		return warning(client.nickname() + " is not an operator in channel " + channelName);
+		sendMSG(client, ERR_CHANOPPROVSNEEDED(client, channelName));
+		sendMSG(client, NOTICE(client.nickname(), "You are not a channel operator"));
+		return LOGF_WARNING("%s is not an operator in channel %s", client.nickname(), channelName);
 	}
+	std::string topic = msg.arg(1);
 	channel->setTopic(topic, client.nickname());
-	info(client.nickname() + " changed topic of channel " + channel->getName() + " to: " + topic);
+	LOGF_INFO("%s changed topic of channel %s to: %s", client.nickname(), channel->getName(), topic);
 	channel->broadcast(RPL_TOPIC(client, channel->getName(), topic));
 }
 
-void MsgHandler::handlePRIVMSG(std::string &msg, Client &client)
+void MsgHandler::handlePRIVMSG(const IrcMessage &msg, Client &client)
 {
-	const std::vector<std::string> &trailing = split(msg, ':');
-	const std::vector<std::string> &command = split(trailing[0], ' ');
-
-	if (trailing.size() < 2 || command.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, "PRIVMSG"));
-		return warning("Insufficient parameters for PRIVMSG command");
-	}
-	std::string channelName = command.at(1);
-    std::string message = trailing.at(1);
-
-	if (msg.find("!quote") != std::string::npos)
-	{
-		_manager.forwardPrivateMessage(channelName, msg, client);
-		handleQuote(channelName, client);
-		return;
-	}
+	std::string channelName = msg.arg(0);
+	std::string message = msg.arg(1);
 
 	_manager.forwardPrivateMessage(channelName, message, client);
+	if (message.find("!quote") != std::string::npos)
+		handleQuote(channelName, client);
 }
 
-void MsgHandler::handleKILL(std::string &msg, Client &killer)
+void MsgHandler::handleKILL(const IrcMessage &msg, Client &killer)
 {
-	if (!killer.isIRCOp())
-	{
-		sendMSG(killer.getFd(), ERR_NOPRIVILAGES(killer));
-		return ;
-	}
-
-	std::istringstream ss(msg);
-	std::string killCommand, userToKill, reasonToKill;
-	getline(ss, killCommand, ' ');
-	getline(ss, userToKill, ' ');
-	getline(ss, reasonToKill);
+	std::string userToKill = msg.arg(0);
+	std::string reasonToKill = msg.arg(1);
 
 	Client *client = _server.getClientByNick(userToKill);
 	if (client)
 	{
 		Client& victim = *client;
 
-		std::vector<Channel*> clientChannels = client->getClientChannels();
-		for (size_t i = 0; i < clientChannels.size(); i++)
+		const std::vector<Membership *> &memberships = victim.getMemberships();
+		while (!memberships.empty())
 		{
-			clientChannels[i]->broadcast(KILL(killer, victim, clientChannels[i], reasonToKill));
-			_manager.removeFromChannel(clientChannels[i]->getName(), victim);
+			Channel *channel = memberships.back()->channel;
+			channel->broadcast(KILL(killer, victim, channel, reasonToKill));
+			_manager.removeFromChannel(channel->getName(), victim);
 		}
-		sendMSG(victim.getFd(), QUITKILLEDBY(victim, killer, reasonToKill));
+		sendMSG(victim, QUITKILLEDBY(victim, killer, reasonToKill));
 		_server.disconnectClient(&victim);
 		return ;
 	}
 }
 
-void MsgHandler::handleQUIT(std::string &msg, Client &client)
+void MsgHandler::handleQUIT(const IrcMessage &msg, Client &client)
 {
-	std::vector<std::string> msgData = split(msg, ':');
-	if (msgData.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for JOIN command");
-	}
-	std::string message = (msgData[1].empty()) ? "No reason given" : msgData[1];
+	std::string message = msg.param(0).empty() ? "No reason given" : msg.arg(0);
 
-	std::vector<Channel*>& clientChannels = client.getClientChannels();
-	for (size_t i = 0; i < clientChannels.size(); i++)
+	const std::vector<Membership *> &memberships = client.getMemberships();
+	while (!memberships.empty())
 	{
-		clientChannels[i]->broadcast(QUIT(client, message));
-		_manager.removeFromChannel(clientChannels[i]->getName(), client);
+		Channel *channel = memberships.back()->channel;
+		channel->broadcast(QUIT(client, message));
+		_manager.removeFromChannel(channel->getName(), client);
 	}
 	_server.disconnectClient(&client);
 }
 
-void MsgHandler::handleDIE(Client &client)
+void MsgHandler::handleDIE(const IrcMessage &msg, Client &client)
 {
-	if (!client.isIRCOp())
-		return sendMSG(client.getFd(), ERR_NOPRIVILAGES(client));
-
+	(void)msg;
+	(void)client;
 	clients_t &allClients = _server.getClients();
-	for (clients_t::iterator it = allClients.begin(); it != allClients.end(); ++it)
+	for (size_t n = 0; n < allClients.size(); n++)
 	{
-		Client &c = *it->second;
-		std::vector<Channel *> clientChannels = c.getClientChannels();
-		for (size_t i = 0; i < clientChannels.size();i++)
-		{
-  		  	sendMSG(c.getFd(), RPL_NOTINCHANNEL(c, clientChannels[i]->getName()));
-		}
-		sendMSG(c.getFd(), DIE(c));
+		Client &c = *allClients[n];
+		const std::vector<Membership *> &memberships = c.getMemberships();
+		for (size_t i = 0; i < memberships.size(); i++)
+			sendMSG(c, RPL_NOTINCHANNEL(c, memberships[i]->channel->getName()));
+		sendMSG(c, DIE(c));
 	}
-	info("DIE command received. Server shutting down...");
+	LOGF_INFO("DIE command received. Server shutting down...");
 	_server.shutdown();
 }
 
-void MsgHandler::handleNICK(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handlePING(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 2) {
-		return sendMSG(client.getFd(), ERR_NONICKNAMEGIVEN(client));
+	(void)msg;
+	sendMSG(client, PONG);
+}
+
+/*
+** STATS m: commands received, u: uptime, t: traffic counters, h: latency
+** and fan-out histograms, z: memory pools. Anything else only gets the end
+** of report.
+*/
+void MsgHandler::handleSTATS(const IrcMessage &msg, Client &client)
+{
+	ServerStats	&stats = Server::stats;
+	char		query = msg.param(0).empty() ? '*' : msg.param(0).data[0];
+	std::time_t	now = std::time(0);
+
+	if (query == 'm')
+	{
+		for (int type = 0; type < COMMAND_COUNT; type++)
+		{
+			if (stats.commands[type] > 0)
+				sendMSG(client, RPL_STATSCOMMANDS(client, commandName(static_cast<Command>(type)), stats.commands[type]));
+		}
 	}
+	else if (query == 'u')
+	{
+		long	up = now - stats.startTime;
+		char	uptime[64];
 
-	std::string nickname = msgData[1];
-	if (client.nickname() == "undefined")
+		snprintf(uptime, sizeof(uptime), "%ld days %ld:%02ld:%02ld", up / 86400, up % 86400 / 3600, up % 3600 / 60, up % 60);
+		sendMSG(client, RPL_STATSUPTIME(client, uptime));
+	}
+	else if (query == 't')
 	{
-		int i = 1;
-		while (_server.getClientByNick(nickname))
-		{		
-			nickname = msgData[1] + intToString(i++);
+		size_t	uptime = std::max(static_cast<size_t>(now - stats.startTime), (size_t)1);
+		size_t	window = std::max(static_cast<size_t>(now - stats.sampleTime), (size_t)1);
+
+		sendMSG(client, RPL_STATSTEXT(client, query, "clients " << _server.getClients().size()
+			<< " channels " << _manager.getChannelCount()));
+		sendMSG(client, RPL_STATSTEXT(client, query, "connections " << stats.connections
+			<< " registrations " << stats.registrations));
+		sendMSG(client, RPL_STATSTEXT(client, query, "messages " << stats.messages
+			<< " average/s " << stats.messages / uptime
+			<< " recent/s " << (stats.messages - stats.sampleMessages) / window));
+		sendMSG(client, RPL_STATSTEXT(client, query, "bytes read " << stats.bytesRead
+			<< " written " << stats.bytesWritten));
+		sendMSG(client, RPL_STATSTEXT(client, query, "fan-out broadcasts " << stats.broadcasts
+			<< " lines " << stats.fanoutLines << " bytes " << stats.fanoutBytes));
+		sendMSG(client, RPL_STATSTEXT(client, query, "writes short " << stats.shortWrites
+			<< " failed " << stats.failedWrites));
+		sendMSG(client, RPL_STATSTEXT(client, query, "sendq queued " << SendQueue::totalQueued()
+			<< " bytes evicted " << stats.sendqEvictions));
+		stats.sampleTime = now;
+		stats.sampleMessages = stats.messages;
+	}
+	else if (query == 'h')
+	{
+		for (int type = 0; type < COMMAND_COUNT; type++)
+		{
+			if (stats.latency[type].count() > 0)
+				sendMSG(client, RPL_STATSTEXT(client, query, commandName(static_cast<Command>(type))
+					<< " ns " << _percentiles(stats.latency[type])));
 		}
+		sendMSG(client, RPL_STATSTEXT(client, query, "fan-out recipients " << _percentiles(stats.fanout)));
+	}
+	else if (query == 'z')
+	{
+		const std::vector<SlabPool *>	&pools = SlabPool::pools();
+		for (size_t i = 0; i < pools.size(); i++)
+			sendMSG(client, RPL_STATSTEXT(client, query, pools[i]->report()));
+	}
+	sendMSG(client, RPL_ENDOFSTATS(client, query));
+}
+
+/* "count N p50 N p99 N p999 N max N" */
+std::string MsgHandler::_percentiles(const Histogram &histogram)
+{
+	char	line[160];
+
+	snprintf(line, sizeof(line), "count %llu p50 %llu p99 %llu p999 %llu max %llu",
+		static_cast<unsigned long long>(histogram.count()),
+		static_cast<unsigned long long>(histogram.percentile(0.5)),
+		static_cast<unsigned long long>(histogram.percentile(0.99)),
+		static_cast<unsigned long long>(histogram.percentile(0.999)),
+		static_cast<unsigned long long>(histogram.max()));
+	return (line);
+}
+
+void MsgHandler::handleLUSERS(const IrcMessage &msg, Client &client)
+{
+	ServerStats	&stats = Server::stats;
+
+	(void)msg;
+	sendMSG(client, RPL_LUSERCLIENT(client, stats.usersOnline));
+	sendMSG(client, RPL_LUSEROP(client, stats.opersOnline));
+	sendMSG(client, RPL_LUSERUNKNOWN(client, stats.unknownOnline));
+	sendMSG(client, RPL_LUSERCHANNELS(client, _manager.getChannelCount()));
+	sendMSG(client, RPL_LUSERME(client, _server.getClients().size()));
+}
+
+void MsgHandler::handleNICK(const IrcMessage &msg, Client &client)
+{
+	if (msg.param(0).empty()) {
+		return sendMSG(client, ERR_NONICKNAMEGIVEN(client));
 	}
-	else if ((_server.getClientByNick(nickname))) {
-		return sendMSG(client.getFd(), ERR_NICKNAMEINUSE(client, msgData[1]));
+
+	std::string requested = msg.arg(0);
+	std::string nickname = requested;
+	if (client.nickname() == "undefined")
+		nickname = _server.uniqueNickname(requested);
+	else
+	{
+		Client *owner = _server.getClientByNick(nickname);
+		if (owner && owner != &client)
+			return sendMSG(client, ERR_NICKNAMEINUSE(client, requested));
 	}
-	client.setNickname(nickname);
+	_server.renameClient(client, nickname);
 }
 
 
@@ -183,171 +260,186 @@ void	MsgHandler::handleQuote(const std::string& channelTarget, Client& client)
 {
 	if (!_server.getQuoteBot()->initiateConnection(_server))
 	{
-		info("Failed to connect to QuoteBot API");
+		LOGF_INFO("Failed to connect to QuoteBot API");
 		return;
 	}
 	_server.getQuoteBot()->setRequesterClient(&client);
 	_server.getQuoteBot()->setRequesterChannel(channelTarget);
 }
 
-void MsgHandler::handlePART(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handlePART(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for MODE command");
-	}
-	_manager.removeFromChannel(msgData[1], client);
+	_manager.removeFromChannel(msg.arg(0), client);
 }
 
-void MsgHandler::handlePASS(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handlePASS(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for MODE command");
-	}
-	_server.validatePassword(msgData[1], client);
+	std::string password = msg.arg(0);
+	_server.validatePassword(password, client);
 }
 
-void MsgHandler::handleOPER(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handleOPER(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 3) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for OPER command");
-	}
-	std::string &nickname = msgData[1];
-	std::string &password = msgData[2];
+	std::string nickname = msg.arg(0);
+	std::string password = msg.arg(1);
 
 	_server.validateIRCOp(nickname, password, client);
 }
 
-void MsgHandler::handleJOIN(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handleJOIN(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 2) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for JOIN command");
-	}
-	if (msgData[1][0] != '#') {
-		sendMSG(client.getFd(), ERR_BADCHANMASK(client, msgData[1]));
-		return warning("Channel " + msgData[1] + " does not exist");
+	std::string channelName = msg.arg(0);
+	if (channelName[0] != '#') {
+		sendMSG(client, ERR_BADCHANMASK(client, channelName));
+		return LOGF_WARNING("Channel %s does not exist", channelName);
 	}
-	std::string &channelName = msgData[1];
-	std::string channelKey = (msgData.size() == 3) ? msgData[2] : "";
+	std::string channelKey = msg.arg(1);
 
 	_manager.addToChannel(channelName, channelKey, client);
 }
 
-void MsgHandler::handleINVITE(std::vector<std::string> &msgData, Client &client)
+void MsgHandler::handleINVITE(const IrcMessage &msg, Client &client)
 {
-	if (msgData.size() < 3) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, msgData[0]));
-		return warning("Insufficient parameters for INVITE command");
-	}
-	std::string &channelName = msgData[1];
-	std::string &nickname = msgData[2];
+	std::string channelName = msg.arg(0);
+	std::string nickname = msg.arg(1);
   	
 	_manager.inviteClient(channelName, nickname, client);
 }
 
-void MsgHandler::handleKICK(std::string &msg, Client &client)
+void MsgHandler::handleKICK(const IrcMessage &msg, Client &client)
 {
-	std::string channelName, userToKick, reason;
-	const std::vector<std::string> &msgData = split(msg, ':');
-	const std::vector<std::string> &names = split(msgData[0], ' ');
-
-	if (msgData.size() < 2 || names.size() < 3) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, "KICK"));
-		return warning("Insufficient parameters for KICK command");
-	}
-	channelName = names[1];
-	userToKick = names[2];
-	reason = (msgData.size() > 1) ? msgData[1] : "No reason given";
+	std::string channelName = msg.arg(0);
+	std::string userToKick = msg.arg(1);
+	std::string reason = msg.param(2).empty() ? "No reason given" : msg.arg(2);
 
 	_manager.kickFromChannel(channelName, userToKick, reason, client);
 }
-void MsgHandler::handleUSER(std::string &msg, Client &client)
-{
-	std::string username, hostname, IP, fullName;
-	const std::vector<std::string> &msgData = split(msg, ':');
-	const std::vector<std::string> &names = split(msgData[0], ' ');
 
-	if (msgData.size() < 2 || names.size() < 4) {
-		sendMSG(client.getFd(), ERR_NEEDMOREPARAMS(client, "KICK"));
-		return warning("Insufficient parameters for KICK command");
-	}
+/*
+** USER <username> <hostname> <servername> :<realname>
+*/
+void MsgHandler::handleUSER(const IrcMessage &msg, Client &client)
+{
+	std::string username = msg.arg(0);
+	std::string hostname = msg.arg(1);
+	std::string IP;
+	std::string fullName = msg.arg(3);
 
-	client.assignUserData(username, hostname, IP, fullName);
+	_server.setClientUsername(client, username);
+	client.assignUserData(hostname, IP, fullName);
 }
 
-void MsgHandler::respond(std::string &msg, Client &client)
+/*
+** Timed per command on the monotonic clock, checks included, for STATS h.
+** The caller already looked the command up (NULL when it is unknown).
+*/
+void MsgHandler::respond(const CommandSpec *spec, const IrcMessage &msg, Client &client)
 {
-	std::vector<std::string> msgData = split(msg, ' ');
+	Server::stats.messages++;
+	Server::stats.commands[spec ? spec->type : UNKNOWN]++;
+	if (!spec)
+		return ;
 
-	switch (getCommandType(msgData[0]))
+	uint64_t	start = monotonicNs();
+	_dispatch(spec, msg, client);
+	Server::stats.latency[spec->type].record(monotonicNs() - start);
+}
+
+/*
+** Registration, operator status and parameter count are checked here from
+** the command table, so the handlers only see messages they can act on.
+** NICK before a valid PASS disconnects the client.
+*/
+void MsgHandler::_dispatch(const CommandSpec *spec, const IrcMessage &msg, Client &client)
+{
+	if (!client.isRegistered())
+	{
+		if (spec->type == NICK)
+		{
+			LOGF_ERROR("Invalid or no password: client disconnected.");
+			sendMSG(client, ERR_PASSWDMISMATCH(client));
+			return _server.disconnectClient(&client);
+		}
+		if (spec->flags & CMD_REGISTERED)
+			return sendMSG(client, ERR_NOTREGISTERED(client));
+	}
+	if ((spec->flags & CMD_OPER) && !client.isIRCOp())
+		return sendMSG(client, ERR_NOPRIVILAGES(client));
+	if (msg.paramCount() < spec->minParams)
 	{
-		case PASS: handlePASS(msgData, client);
-			break ;
-		case OPER: handleOPER(msgData, client); 
-			break ;
-		case JOIN: handleJOIN(msgData, client);
-			break ;
-		case PART: handlePART(msgData, client);
-			break ;
-		case INVITE: handleINVITE(msgData, client);
-			break ;
-		case KICK: handleKICK(msg, client);
-			break ;
-		case USER: handleUSER(msg, client);
-			break ;
-		case QUIT: handleQUIT(msg, client);
-			break ;
-		case NICK: handleNICK(msgData, client);
-			break ;
-		case MODE: handleMODE(msgData, client);
-			break ;
-		case TOPIC: handleTOPIC(msg, client);
-			break ;
-		case KILL: handleKILL(msg, client);
-			break ;
-		case DIE: handleDIE(client);
-			break ;
-		case PING: sendMSG(client.getFd(), PONG);
-			break ;
-		case PRIVMSG: handlePRIVMSG(msg, client);
-			break ;
-		case UNKNOWN:
-			break ;
+		sendMSG(client, ERR_NEEDMOREPARAMS(client, spec->name));
+		return LOGF_WARNING("Insufficient parameters for %s command", spec->name);
 	}
+	(this->*spec->handler)(msg, client);
 }
 
-void	MsgHandler::receiveMessage(Client &client)
+/*
+** Reads straight into the client's input buffer. A buffer full of lines not
+** parsed yet (the client was cut short last time) is not read into and
+** READ_SKIPPED is returned; the caller parses them first.
+*/
+ssize_t	MsgHandler::readInput(Client &client)
 {
-	char		buffer[1024];
-	ssize_t bytes_read = read(client.getFd(), buffer, sizeof(buffer) - 1);
-	if (bytes_read <= 0) {
-		return _server.disconnectClient(&client);
-	}
-	buffer[bytes_read] = '\0';
-	if (!strcmp(buffer, "\r\n")) {
-		return ;
+	size_t	room;
+	char	*space = client.getInput().reserve(room);
+	if (room == 0)
+		return (READ_SKIPPED);
+
+	ssize_t bytes_read = read(client.getFd(), space, room);
+	if (bytes_read > 0)
+		client.getInput().commit(bytes_read);
+	return (bytes_read);
+}
+
+/*
+** Bytes the event backend received for the client. Whatever does not fit in
+** the input buffer waits for the lines ahead of it to be parsed; those are
+** parsed even past the client's flood limit, since the bytes are already
+** here, and only deepen its token debt.
+*/
+void	MsgHandler::appendInput(Client &client, const char *data, size_t length)
+{
+	while (length > 0 && !client.isDisconnected())
+	{
+		size_t	taken = client.getInput().append(data, length);
+		data += taken;
+		length -= taken;
+		if (length > 0)
+			_processLines(client, false);
 	}
-	// std::cout << buffer; // for testing only
+}
 
-	client.msgBuffer += buffer;
-	size_t i;
-	size_t clientCount = _server.getClients().size();
-	while ((i = client.msgBuffer.find("\r\n")) != std::string::npos)
+/*
+** Empty lines are ignored, as RFC 1459 allows. A client may be disconnected
+** by its own line (QUIT, a failed registration), which ends the loop.
+*/
+void	MsgHandler::processInput(Client &client) { _processLines(client, true); }
+
+/*
+** Each line spends its command's cost in line tokens and its length in byte
+** tokens before it is handled. Once either bucket is empty the remaining
+** input stays in the buffer and the client's loop stops reading from it
+** until the tokens refill.
+*/
+void	MsgHandler::_processLines(Client &client, bool limited)
+{
+	StringView	line;
+	IrcMessage	msg;
+	uint64_t	now = monotonicNs();
+
+	while (!client.isDisconnected())
 	{
-		std::string message = client.msgBuffer.substr(0, i);
-		client.msgBuffer.erase(0, i + 2);
-		if (!client.isRegistered() && split(message, ' ').front() == "NICK")
-		{
-			error("Invalid or no password: client disconnected.");
-			sendMSG(client.getFd(), ERR_PASSWDMISMATCH(client));
-			_server.disconnectClient(&client);
+		if (limited && !client.hasTokens(now))
+			return (client.getLoop()->throttle(&client));
+		if (!client.getInput().nextLine(line))
 			return ;
+		if (!msg.parse(line))
+		{
+			client.spendTokens(1, line.size + 2);
+			continue ;
 		}
-		respond(message, client);  // maybe take PASS out of this funciton
-		if (_server.getClients().size() < clientCount)
-			return ;
+		const CommandSpec	*spec = findCommand(msg.command());
+		client.spendTokens(spec ? spec->cost : 1, line.size + 2);
+		respond(spec, msg, client);
 	}
 }
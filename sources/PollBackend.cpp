@@ -0,0 +1,86 @@
+#include "../include/irc.hpp"
+#include "../include/PollBackend.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+PollBackend::PollBackend(void) {}
+
+PollBackend::~PollBackend(void) {}
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+int	PollBackend::_indexOf(int fd) const
+{
+	if (fd < 0 || (size_t)fd >= _index.size())
+		return (-1);
+	return (_index[fd]);
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+const char	*PollBackend::name(void) const { return "poll"; }
+
+bool	PollBackend::add(int fd, short events, void *data)
+{
+	pollfd	pfd;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	pfd.revents = 0;
+	if ((size_t)fd >= _index.size())
+		_index.resize(fd + 1, -1);
+	_index[fd] = _pollfds.size();
+	_pollfds.push_back(pfd);
+	_data.push_back(data);
+	return (true);
+}
+
+bool	PollBackend::modify(int fd, short events, void *data)
+{
+	int	i = _indexOf(fd);
+
+	if (i < 0)
+		return (false);
+	_pollfds[i].events = events;
+	_data[i] = data;
+	return (true);
+}
+
+void	PollBackend::remove(int fd)
+{
+	int	i = _indexOf(fd);
+
+	if (i < 0)
+		return ;
+	_pollfds[i] = _pollfds.back();
+	_data[i] = _data.back();
+	_index[_pollfds[i].fd] = i;
+	_pollfds.pop_back();
+	_data.pop_back();
+	_index[fd] = -1;
+}
+
+int	PollBackend::wait(std::vector<IOEvent> &ready, int timeout)
+{
+	ready.clear();
+	int activity = poll(_pollfds.data(), _pollfds.size(), timeout);
+	for (size_t i = 0; i < _pollfds.size() && (int)ready.size() < activity; i++)
+	{
+		if (_pollfds[i].revents == 0)
+			continue ;
+		IOEvent	event;
+		event.fd = _pollfds[i].fd;
+		event.events = _pollfds[i].revents;
+		event.data = _data[i];
+		event.result = 0;
+		event.buffer = NULL;
+		ready.push_back(event);
+	}
+	return (activity);
+}
@@ -0,0 +1,125 @@
+#include "../include/irc.hpp"
+
+char	Reply::_serverPrefix[64] = ":";
+size_t	Reply::_serverPrefixLength = 1;
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+Reply::Reply(void) : _length(0)
+{
+	_append("", 0);
+}
+
+/* :<server> <command> */
+Reply::Reply(const char *command) : _length(0)
+{
+	_append(_serverPrefix, _serverPrefixLength);
+	*this << command;
+}
+
+/* :<server> <numeric> <target nick> */
+Reply::Reply(const char *numeric, const Client &target) : _length(0)
+{
+	_append(_serverPrefix, _serverPrefixLength);
+	*this << numeric << ' ' << target.nickname();
+}
+
+/* :<nick>!<user>@<host>, cached by the client */
+Reply::Reply(const Client &source) : _length(0)
+{
+	*this << source.prefix();
+}
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/*
+** Keeps CRLF written after the content, so the line is complete after every
+** append; text that does not fit before it is dropped.
+*/
+void	Reply::_append(const char *text, size_t length)
+{
+	size_t	room = REPLY_MAX_LENGTH - 2 - _length;
+
+	if (length > room)
+		length = room;
+	std::memcpy(_line + _length, text, length);
+	_length += length;
+	_line[_length] = '\r';
+	_line[_length + 1] = '\n';
+}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+const char	*Reply::data(void) const { return (_line); }
+
+size_t	Reply::size(void) const { return (_length + 2); }
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/*
+** Called once at startup, before any reply is built.
+*/
+void	Reply::setServerName(const std::string &name)
+{
+	size_t	length = std::min(name.size(), sizeof(_serverPrefix) - 2);
+
+	_serverPrefix[0] = ':';
+	std::memcpy(_serverPrefix + 1, name.data(), length);
+	_serverPrefix[length + 1] = ' ';
+	_serverPrefixLength = length + 2;
+}
+
+Reply	&Reply::operator<<(const char *text)
+{
+	_append(text, std::strlen(text));
+	return (*this);
+}
+
+Reply	&Reply::operator<<(const std::string &text)
+{
+	_append(text.data(), text.size());
+	return (*this);
+}
+
+Reply	&Reply::operator<<(const StringView &text)
+{
+	_append(text.data, text.size);
+	return (*this);
+}
+
+Reply	&Reply::operator<<(char c)
+{
+	_append(&c, 1);
+	return (*this);
+}
+
+Reply	&Reply::operator<<(int value)
+{
+	if (value < 0)
+	{
+		*this << '-';
+		return (*this << static_cast<size_t>(-static_cast<long>(value)));
+	}
+	return (*this << static_cast<size_t>(value));
+}
+
+Reply	&Reply::operator<<(size_t value)
+{
+	char	digits[24];
+	size_t	pos = sizeof(digits);
+
+	do {
+		digits[--pos] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	_append(digits + pos, sizeof(digits) - pos);
+	return (*this);
+}
@@ -0,0 +1,192 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                             Static Variables                               //
+// ************************************************************************** //
+
+size_t	SendQueue::_queued = 0;
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+SendQueue::SendQueue(void) : _tail(NULL), _offset(0), _bytes(0), _unsettled(0) {}
+
+SendQueue::~SendQueue(void) { clear(); }
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+bool	SendQueue::empty(void) const { return (size() == 0); }
+
+size_t	SendQueue::size(void) const { return (__atomic_load_n(&_bytes, __ATOMIC_RELAXED)); }
+
+size_t	SendQueue::totalQueued(void) { return (_queued); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+/* Takes `sent` bytes off the front; the emptied chunks wait for settle() */
+void	SendQueue::_drop(size_t sent)
+{
+	__atomic_store_n(&_bytes, _bytes - sent, __ATOMIC_RELAXED);
+	_unsettled += sent;
+	while (sent > 0)
+	{
+		size_t	left = _chunks.front()->size() - _offset;
+		if (sent < left)
+		{
+			_offset += sent;
+			return ;
+		}
+		sent -= left;
+		if (_chunks.front() == _tail)
+			_tail = NULL;
+		_spent.push_back(_chunks.front());
+		_chunks.pop_front();
+		_offset = 0;
+	}
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+void	SendQueue::push(const std::string &data) { push(data.data(), data.size()); }
+
+void	SendQueue::push(const char *data, size_t length)
+{
+	if (length == 0)
+		return ;
+	if (!_tail || _tail->room() < length)
+	{
+		_tail = SharedBuffer::create(std::max(length, static_cast<size_t>(SENDQ_CHUNK_SIZE)));
+		_chunks.push_back(_tail);
+	}
+	_tail->append(data, length);
+	__atomic_store_n(&_bytes, _bytes + length, __ATOMIC_RELAXED);
+	_queued += length;
+}
+
+void	SendQueue::push(SharedBuffer *buffer)
+{
+	if (buffer->size() == 0)
+		return ;
+	buffer->retain();
+	_chunks.push_back(buffer);
+	_tail = NULL;
+	__atomic_store_n(&_bytes, _bytes + buffer->size(), __ATOMIC_RELAXED);
+	_queued += buffer->size();
+}
+
+/*
+** Moves every chunk of `from`, a queue never written from, behind ours and
+** leaves it empty. The bytes stay counted in the total; nothing is appended
+** to a chunk moved here again.
+*/
+void	SendQueue::splice(SendQueue &from)
+{
+	if (from._chunks.empty())
+		return ;
+	if (_chunks.empty())
+		_chunks.swap(from._chunks);
+	else
+		_chunks.insert(_chunks.end(), from._chunks.begin(), from._chunks.end());
+	__atomic_store_n(&_bytes, _bytes + from._bytes, __ATOMIC_RELAXED);
+	__atomic_store_n(&from._bytes, 0, __ATOMIC_RELAXED);
+	from._chunks.clear();
+	from._tail = NULL;
+	_tail = NULL;
+}
+
+/*
+** Writes until the queue is empty or the socket would block. Returns the
+** number of bytes written, or -1 if the socket failed for good. Safe without
+** the state lock, see settle().
+*/
+ssize_t	SendQueue::send(int fd)
+{
+	ssize_t	total = 0;
+	iovec	iov[SENDQ_IOV_MAX];
+	msghdr	msg;
+
+	while (!_chunks.empty())
+	{
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = gather(iov, NULL, SENDQ_IOV_MAX);
+
+		ssize_t	sent = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break ;
+			return (-1);
+		}
+		total += sent;
+		_drop(sent);
+	}
+	return (total);
+}
+
+ssize_t	SendQueue::flush(int fd)
+{
+	ssize_t	sent = send(fd);
+
+	settle();
+	return (sent);
+}
+
+/*
+** Fills iov with the unsent part of the first chunks; refs, when given,
+** receives the matching buffers so a caller sending asynchronously can keep
+** them alive. Returns the number of entries filled.
+*/
+size_t	SendQueue::gather(iovec *iov, SharedBuffer **refs, size_t max) const
+{
+	size_t	count = 0;
+
+	for (std::deque<SharedBuffer *>::const_iterator it = _chunks.begin();
+			it != _chunks.end() && count < max; ++it, ++count)
+	{
+		size_t	skip = (count == 0) ? _offset : 0;
+		iov[count].iov_base = const_cast<char *>((*it)->data() + skip);
+		iov[count].iov_len = (*it)->size() - skip;
+		if (refs)
+			refs[count] = *it;
+	}
+	return (count);
+}
+
+/* Drops `sent` bytes from the front of the queue */
+void	SendQueue::consume(size_t sent)
+{
+	_drop(sent);
+	settle();
+}
+
+/* Releases what send() took off since, with the state lock held */
+void	SendQueue::settle(void)
+{
+	for (size_t i = 0; i < _spent.size(); i++)
+		_spent[i]->release();
+	_spent.clear();
+	_queued -= _unsettled;
+	_unsettled = 0;
+}
+
+void	SendQueue::clear(void)
+{
+	settle();
+	for (size_t i = 0; i < _chunks.size(); i++)
+		_chunks[i]->release();
+	_chunks.clear();
+	_tail = NULL;
+	_offset = 0;
+	_queued -= _bytes;
+	__atomic_store_n(&_bytes, 0, __ATOMIC_RELAXED);
+}
@@ -7,40 +7,54 @@ Server::Server(int port, std::string &password)
 {
 	_port = port;
 	_password = password;
+	_manager = NULL;
+	_msgHandler = NULL;
 	_quoteBot = new QuoteBot();
+	_reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	pthread_mutex_init(&_stateLock, NULL);
+	stats.startTime = std::time(0);
+	stats.sampleTime = stats.startTime;
+	Reply::setServerName(SERVER_NAME);
 	parseOpersConfigFile("./include/opers.config");
-	
-	pollfd		listeningSocket;
-	listeningSocket.fd = socket(AF_INET, SOCK_STREAM, 0);
-	listeningSocket.events = POLLIN;
-	listeningSocket.revents = 0;
-	_sockets.push_back(listeningSocket);
-	
-	sockaddr_in	serverAddr;
-	memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serverAddr.sin_port = htons(_port);
-
-	int opt = 1;
-	setsockopt(_sockets[0].fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-	if (fcntl(_sockets[0].fd, F_SETFL, O_NONBLOCK) < 0) {
-		error("fcntl failure");
-		exit(-1);
-	}
-	bind(_sockets[0].fd, (struct sockaddr *)(&serverAddr), sizeof(serverAddr));
-	listen(_sockets[0].fd, 10);
+	parseServerConfigFile("./include/server.config");
+	Logger::start(getConfigSize("log_ring_size", 4096), getConfig("log_full_policy", "drop") == "block",
+		getConfig("log_binary_file", ""));
+	_recvBufferSize = std::max(getConfigSize("recv_buffer_size", 8192), (size_t)MAX_LINE_LENGTH);
+	_floodLines = getConfigSize("flood_lines_per_sec", 20);
+	_floodLineBurst = getConfigSize("flood_line_burst", 50);
+	_floodBytes = getConfigSize("flood_bytes_per_sec", 4096);
+	_floodByteBurst = getConfigSize("flood_byte_burst", 16384);
+	_sendqMax = getConfigSize("sendq_max", 1048576);
+	_sendqMaxOper = getConfigSize("sendq_max_oper", 4194304);
+
+	size_t	loopCount = std::atoi(getConfig("event_loops", "1").c_str());
+	if (loopCount < 1)
+		loopCount = 1;
+	for (size_t i = 0; i < loopCount; i++)
+		_loops.push_back(new EventLoop(*this, i, _port, loopCount > 1));
+	info(std::string("Event backend: ") + _loops[0]->getBackend().name()
+		+ ", " + sizeToString(loopCount) + " event loop(s)");
 }
 
 Server::~Server()
 {
-	for (unsigned int i = 0; i < _sockets.size(); i++)
-		close(_sockets[i].fd);
+	bool	directFlush = !_loops[0]->getBackend().completesIO();
 
-	for (clients_t::iterator it = _clients.begin(); it != _clients.end(); it++)
-		delete it->second;
+	for (size_t i = 0; i < _clients.size(); i++)
+	{
+		if (directFlush)
+			_clients[i]->takeOutput().flush(_clients[i]->getFd());
+		close(_clients[i]->getFd());
+		delete _clients[i];
+	}
+	for (size_t i = 0; i < _loops.size(); i++)
+		delete _loops[i];
 
+	if (_reserveFd >= 0)
+		close(_reserveFd);
+	pthread_mutex_destroy(&_stateLock);
 	delete _quoteBot;
+	Logger::stop();
 }
 
 // ************************************************************************** //
@@ -52,28 +66,46 @@ std::string Server::getPassword(void) { return (_password); }
 
 std::map<std::string,std::string> Server::getOpers(void) { return (_opers); }
 
-Client*	Server::getClientByUser(std::string& username) const
+/*
+** Names are matched under the RFC 1459 case mapping. Usernames need not be
+** unique; any client using the name is returned.
+*/
+Client*	Server::getClientByUser(const std::string& username) const
 {
-	for (clients_t::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
-	{
-		if (it->second->nickname() == username)
-			return (it->second);
-	}
-	return (NULL);
+	const std::vector<Client *>	*users = _usernames.find(username);
+	return (users ? users->front() : NULL);
 }
 
-Client*	Server::getClientByNick(std::string& nickname) const
+Client*	Server::getClientByNick(const std::string& nickname) const
 {
-	for (clients_t::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
-	{
-		if (it->second->nickname() == nickname)
-			return (it->second);
-	}
-	return (NULL);
+	Client *const	*client = _nicknames.find(nickname);
+	return (client ? *client : NULL);
 }
 
 QuoteBot*	Server::getQuoteBot(void) { return (_quoteBot); }
 
+ChannelManager&	Server::getManager(void) { return (*_manager); }
+
+MsgHandler&	Server::getMsgHandler(void) { return (*_msgHandler); }
+
+bool	Server::isRunning(void) const { return (__atomic_load_n(&_running, __ATOMIC_ACQUIRE)); }
+
+size_t	Server::getConfigSize(const std::string &key, size_t fallback) const
+{
+	std::map<std::string, std::string>::const_iterator it = _config.find(key);
+	if (it == _config.end() || !isDigits(it->second))
+		return (fallback);
+	return (std::strtoul(it->second.c_str(), NULL, 10));
+}
+
+std::string	Server::getConfig(const std::string &key, const std::string &fallback) const
+{
+	std::map<std::string, std::string>::const_iterator it = _config.find(key);
+	if (it == _config.end())
+		return (fallback);
+	return (it->second);
+}
+
 // ************************************************************************** //
 //                             Private Functions                              //
 // ************************************************************************** //
@@ -87,6 +119,44 @@ pollfd	Server::_makePollfd(int fd, short int events, short int revents)
 	return pfd;
 }
 
+/* Drops a leaving client from the nickname and username indexes */
+void	Server::_unindexClient(Client &client)
+{
+	_releaseNickname(client);
+	_unindexUsername(client);
+}
+
+/* The suffix hint of a nickname lives only as long as its holder keeps it */
+void	Server::_releaseNickname(Client &client)
+{
+	if (getClientByNick(client.nickname()) != &client)
+		return ;
+	_nicknames.erase(client.nickname());
+	_nickSuffixes.erase(client.nickname());
+}
+
+void	Server::_unindexUsername(Client &client)
+{
+	std::vector<Client *>	*users = _usernames.find(client.username());
+	if (!users)
+		return ;
+	users->erase(std::remove(users->begin(), users->end(), &client), users->end());
+	if (users->empty())
+		_usernames.erase(client.username());
+}
+
+void	Server::_notifyShutdown(void)
+{
+	for (size_t n = 0; n < _clients.size(); n++)
+	{
+		Client &c = *_clients[n];
+		const std::vector<Membership *> &memberships = c.getMemberships();
+		for (size_t i = 0; i < memberships.size(); i++)
+			sendMSG(c, RPL_NOTINCHANNEL(c, memberships[i]->channel->getName()));
+		sendMSG(c, DIE(c));
+	}
+}
+
 // ************************************************************************** //
 //                             Public Functions                               //
 // ************************************************************************** //
@@ -95,11 +165,17 @@ void	Server::validatePassword(std::string &password, Client &client)
 {
 	if (password == getPassword())
 	{
+		if (!client.isRegistered())
+		{
+			stats.unknownOnline--;
+			stats.usersOnline++;
+		}
 		client.setRegistered(true);
-		sendMSG(client.getFd(), RPL_REGISTERED(client));
+		stats.registrations++;
+		sendMSG(client, RPL_REGISTERED(client));
 	}
 	else
-		sendMSG(client.getFd(), ERR_PASSWDMISMATCH(client));
+		sendMSG(client, ERR_PASSWDMISMATCH(client));
 }
 
 void	Server::validateIRCOp(std::string &nickname, std::string &password, Client &client)
@@ -108,17 +184,29 @@ void	Server::validateIRCOp(std::string &nickname, std::string &password, Client
 	std::map<std::string, std::string>::iterator it = allowedOpers.find(nickname);
 
 	if (it == allowedOpers.end()){
-		return sendMSG(client.getFd(), ERR_NOOPERHOST(client));
+		return sendMSG(client, ERR_NOOPERHOST(client));
 	}
 	if (it->second != password){
-		return sendMSG(client.getFd(), ERR_PASSWDMISMATCH(client));
+		return sendMSG(client, ERR_PASSWDMISMATCH(client));
 	}
-	info(client.nickname() + " set as operator");
+	LOGF_INFO("%s set as operator", client.nickname());
+	if (!client.isIRCOp())
+		stats.opersOnline++;
 	client.setIRCOp(true);
-	sendMSG(client.getFd(), RPL_YOUROPER(client));
+	client.setSendqLimit(_sendqMaxOper);
+	sendMSG(client, RPL_YOUROPER(client));
 }
 
-void	Server::shutdown() { _running = false; }
+void	Server::shutdown()
+{
+	__atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+	for (size_t i = 0; i < _loops.size(); i++)
+		_loops[i]->wake();
+}
+
+void	Server::lock(void) { pthread_mutex_lock(&_stateLock); }
+
+void	Server::unlock(void) { pthread_mutex_unlock(&_stateLock); }
 
 void	Server::parseOpersConfigFile(const char *fileName)
 {
@@ -139,101 +227,201 @@ void	Server::parseOpersConfigFile(const char *fileName)
 	}
 }
 
-void	Server::addclient(pollfd &clientSocket)
+void	Server::parseServerConfigFile(const char *fileName)
 {
-	Client *newClient = new Client(clientSocket);
-	_clients.insert(client_pair_t(clientSocket.fd, newClient));
-	_sockets.push_back(newClient->getSocket());
-}
+	std::ifstream file;
 
-void	Server::disconnectClient(Client *client)
-{
-	info(client->nickname() + " disconnected");
+	file.open(fileName, std::ios::in);
+	if (!file.is_open())
+		return warning(std::string("No server config at ") + fileName + ", using defaults");
 
-	for (unsigned int i = 0; i < _sockets.size(); i++)
+	std::string line;
+	while (std::getline(file, line))
 	{
-		if (_sockets[i].fd == client->getFd())
-		{
-			close(client->getFd());
-			_clients.erase(client->getFd());
-			_sockets.erase(_sockets.begin() + i);
-			delete client;
-			return ;
-		}
+		std::istringstream	ss(line);
+		std::string			key, value;
+		if (!(ss >> key >> value) || key[0] == '#')
+			continue ;
+		_config[key] = value;
 	}
 }
 
-void	Server::handleNewConnectionRequest(void)
+/*
+** The first free one of nick, nick1, nick2... The next suffix to try is kept
+** for every taken nickname that collided, so a popular nickname does not
+** retry all the suffixes already handed out. The hint goes away with the
+** holder of the nickname, so there is never one for a free nickname.
+*/
+std::string	Server::uniqueNickname(const std::string &requested)
 {
-	sockaddr_in		clientAddr;
-	pollfd			clientSocket;
-	unsigned int	addrLen = sizeof(clientAddr);
-	
-	clientSocket.fd = accept(_sockets[0].fd, (sockaddr *)&clientAddr, &addrLen);
-	clientSocket = _makePollfd(clientSocket.fd, POLLIN | POLLHUP | POLLERR, 0);
-	if (clientSocket.fd < 0)
-	{
-		close(_sockets[0].fd);
-		return error("New socket creation failed.");
-	}
-	sendMSG(clientSocket.fd, "CAP * LS : \r\n");
-	addclient(clientSocket);
-  	info("New client connected with fd: " + intToString(clientSocket.fd));
+	if (!getClientByNick(requested))
+		return (requested);
+	int			&next = _nickSuffixes[requested];
+	std::string	nickname;
+	do
+		nickname = requested + intToString(++next);
+	while (getClientByNick(nickname));
+	return (nickname);
 }
 
-void	Server::SIGINTHandler(int signum)
+/*
+** Nickname and username changes go through the server so its indexes follow.
+*/
+void	Server::renameClient(Client &client, std::string &nickname)
 {
-	if (instance == NULL)
-		return error("Server instance is NULL, cannot handle signal");
-	if (signum == SIGINT)
+	_releaseNickname(client);
+	_nicknames[nickname] = &client;
+	client.setNickname(nickname);
+}
+
+void	Server::setClientUsername(Client &client, std::string &username)
+{
+	_unindexUsername(client);
+	client.setUsername(username);
+	_usernames[username].push_back(&client);
+}
+
+/*
+** Every client starts with full flood control buckets (flood_* config) and
+** the SendQ ceiling of the user class; operators get sendq_max_oper.
+*/
+Client*	Server::addclient(pollfd &clientSocket, EventLoop &loop)
+{
+	Client		*newClient = new Client(clientSocket, _recvBufferSize);
+	uint64_t	now = monotonicNs();
+
+	newClient->getLineTokens().setLimit(_floodLines, _floodLineBurst, now);
+	newClient->getByteTokens().setLimit(_floodBytes, _floodByteBurst, now);
+	newClient->setSendqLimit(_sendqMax);
+	_clients.insert(newClient);
+	loop.watch(newClient);
+	return (newClient);
+}
+
+/*
+** Channels still holding the client (connection dropped without a QUIT) are
+** told it quit, with "Connection closed" unless a reason is given, before it
+** leaves them. The socket and the Client object are then handed back to the
+** event loop that owns them.
+*/
+void	Server::disconnectClient(Client *client) { disconnectClient(client, "Connection closed"); }
+
+void	Server::disconnectClient(Client *client, const std::string &reason)
+{
+	if (client->isDisconnected())
+		return ;
+	LOGF_INFO("%s disconnected", client->nickname());
+
+	Client							&quitter = *client;
+	const std::vector<Membership *>	&memberships = quitter.getMemberships();
+	while (!memberships.empty())
 	{
-		info("SIGINT received, shutting server down...");
-		_running = false;
+		Channel *channel = memberships.back()->channel;
+		channel->broadcastSilent(QUIT(quitter, reason), client);
+		_manager->removeFromChannel(channel->getName(), quitter);
 	}
-	for (clients_t::iterator it = instance->_clients.begin(); it != instance->_clients.end(); ++it)
+	if (!client->isRegistered())
+		stats.unknownOnline--;
+	else if (!client->isBot())
+		stats.usersOnline--;
+	if (client->isIRCOp())
+		stats.opersOnline--;
+	_unindexClient(*client);
+	_clients.erase(client->getFd());
+	client->setDisconnected(true);
+	client->getLoop()->release(client);
+}
+
+/*
+** Drains the listener's backlog in one go. Failures never close the listening
+** socket: running out of descriptors sheds the pending connection instead.
+*/
+void	Server::handleNewConnectionRequest(EventLoop &loop)
+{
+	while (true)
 	{
-		Client &c = *it->second;
-		std::vector<Channel *> clientChannels = c.getClientChannels();
-		for (size_t i = 0; i < clientChannels.size();i++)
+		int	fd = accept4(loop.getListenFd(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd >= 0)
 		{
-  		  	sendMSG(c.getFd(), RPL_NOTINCHANNEL(c, clientChannels[i]->getName()));
+			admitClient(fd, loop);
+			continue ;
 		}
-		sendMSG(c.getFd(), DIE(c));
+		if (errno == EINTR || errno == ECONNABORTED)
+			continue ;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			handleAcceptError(errno, loop);
+		return ;
 	}
+}
+
+/*
+** Out of descriptors, the listener would keep reporting the same connection.
+** The reserve fd is given up just long enough to accept and drop it.
+*/
+void	Server::handleAcceptError(int err, EventLoop &loop)
+{
+	if (err == ECONNABORTED)
+		return ;
+	if (err != EMFILE && err != ENFILE)
+		return warning("accept failed: " + std::string(strerror(err)));
+	warning("Out of file descriptors, dropping a pending connection");
+	if (_reserveFd < 0)
+		return ;
+	close(_reserveFd);
+	int	fd = accept(loop.getListenFd(), NULL, NULL);
+	if (fd >= 0)
+		close(fd);
+	_reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+/* Takes over a socket accepted either here or by the loop's backend */
+void	Server::admitClient(int fd, EventLoop &loop)
+{
+	pollfd	clientSocket = _makePollfd(fd, POLLIN | POLLHUP | POLLERR, 0);
+
+	stats.connections++;
+	stats.unknownOnline++;
+	sendMSG(*addclient(clientSocket, loop), Reply() << "CAP * LS : ");
+  	LOGF_INFO("New client connected with fd: %d", fd);
+}
+
+/*
+** Only async-signal-safe work here: the loops are woken and the farewell to
+** connected clients is sent by run() once every loop has stopped.
+*/
+void	Server::SIGINTHandler(int signum)
+{
+	if (instance == NULL || signum != SIGINT)
+		return ;
+	int	savedErrno = errno;
+	_interrupted = true;
 	instance->shutdown();
+	errno = savedErrno;
 }
 
 void Server::addApiSocket(pollfd &api_pfd) {
-    _sockets.push_back(api_pfd);
+    _loops[0]->watchFd(api_pfd.fd, api_pfd.events);
     info("API socket fd " + intToString(api_pfd.fd) + " added for polling.");
 }
 
 void	Server::removeApiSocket(int fd) {
-	for (size_t i = 0; i < _sockets.size(); ++i) {
-		if (_sockets[i].fd == fd) {
-			_sockets.erase(_sockets.begin() + i);
-			info("API socket fd " + intToString(fd) + " removed from polling.");
-			break;
-		}
-	}
+	_loops[0]->getBackend().remove(fd);
+	info("API socket fd " + intToString(fd) + " removed from polling.");
 }
 
-bool	Server::handleApiEvent(pollfd apiFd)
+void	Server::handleApiEvent(const IOEvent &event)
 {
-	if (apiFd.revents & (POLLHUP | POLLERR | POLLNVAL))
+	if (event.events & (POLLHUP | POLLERR | POLLNVAL))
 		_quoteBot->closeApiConnection(*this);
-	else if ((apiFd.revents & POLLOUT) != 0 && _quoteBot->apiState() != RECEIVING)
+	else if ((event.events & POLLOUT) != 0 && _quoteBot->apiState() != RECEIVING)
 	{
 		if (_quoteBot->apiState() == CONNECTING)
 			_quoteBot->handleApiConnectionResult(*this);
 		else if (_quoteBot->apiState() == SENDING)
 			_quoteBot->sendHttpRequest(*this);
 	}
-	else if ((apiFd.revents & POLLIN) && _quoteBot->apiState() == RECEIVING)
+	else if ((event.events & POLLIN) && _quoteBot->apiState() == RECEIVING)
 		_quoteBot->handleAPIMessage(*this);
-	else if (apiFd.revents != 0)
-		return false;
-	return true;
 }
 
 void	Server::setBot()
@@ -249,18 +437,18 @@ void	Server::setBot()
 	_quoteBot->setBotSocketFd(sv[0]);
 	pollfd botSocket = _makePollfd(sv[1], POLLIN | POLLHUP | POLLERR, 0);
 
-	Client *bot = new Client(botSocket);
+	Client *bot = new Client(botSocket, _recvBufferSize);
 	std::string botNickname = std::string(CYAN) + "QuoteBot" + GREEN;
 	std::string botUsername = "QuoteBotAPI";
 	std::string botHostname = "api.forismatic.com";
-	bot->setNickname(botNickname);
-	bot->setUsername(botUsername);
+	renameClient(*bot, botNickname);
+	setClientUsername(*bot, botUsername);
 	bot->setHostname(botHostname);
 	bot->setRegistered(true);
 	bot->setBot(true);
-	_sockets.push_back(botSocket);
 
-	_clients.insert(client_pair_t(sv[1], bot));
+	_clients.insert(bot);
+	_loops[0]->watch(bot);
 	info("Bot " + botNickname + " created with fd: " + intToString(botSocket.fd));
 }
 
@@ -269,50 +457,45 @@ void	Server::run(void)
 	ChannelManager  manager(*this);
 	MsgHandler		msg(*this, manager);
 
+	_manager = &manager;
+	_msgHandler = &msg;
 	Server::instance = this;
 	signal(SIGINT, SIGINTHandler);
 	info("Running...");
 
 	setBot();
-	while (_running)
+
+	sigset_t	blocked, previous;
+	sigemptyset(&blocked);
+	sigaddset(&blocked, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+	for (size_t i = 1; i < _loops.size(); i++)
+		_loops[i]->start();
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+	_loops[0]->run();
+	for (size_t i = 1; i < _loops.size(); i++)
+		_loops[i]->join();
+
+	Logger::tick();
+	if (_interrupted)
 	{
-		int serverActivity = poll(_sockets.data(), _sockets.size(), -1);
-		if (serverActivity > 0)
-		{
-			if (_sockets[0].revents & POLLIN)
-			{
-				handleNewConnectionRequest();
-				serverActivity--;
-			}
-			for (unsigned int i = _sockets.size() - 1; i > 0 && serverActivity > 0; --i)
-			{
-				if (_sockets[i].fd == _quoteBot->getApiSocketFd())
-				{
-					if (handleApiEvent(_sockets[i]) == true)
-					{
-						serverActivity--;
-						continue;
-					}
-				}
-				if (_sockets[i].revents & (POLLHUP | POLLERR | POLLNVAL))
-				{
-					disconnectClient(_clients[_sockets[i].fd]);
-					serverActivity--;
-				}
-				else if (_sockets[i].revents & POLLIN)
-				{
-					msg.receiveMessage(*(_clients[_sockets[i].fd]));
-					serverActivity--;
-				}
-			}
-		}
+		info("SIGINT received, shutting server down...");
+		_notifyShutdown();
 	}
+	for (size_t i = 0; i < _loops.size(); i++)
+		_loops[i]->drain();
+	for (size_t i = 0; i < SlabPool::pools().size(); i++)
+		info(SlabPool::pools()[i]->report());
+	_manager = NULL;
+	_msgHandler = NULL;
 }
 
-
 // ************************************************************************** //
 //                             Static Variables                               //
 // ************************************************************************** //
 
 Server*	Server::instance = NULL;
-bool Server::_running = true;
+ServerStats	Server::stats;
+volatile sig_atomic_t	Server::_running = true;
+volatile sig_atomic_t	Server::_interrupted = false;
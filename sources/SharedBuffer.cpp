@@ -0,0 +1,67 @@
+#include "../include/irc.hpp"
+#include <new>
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+SharedBuffer::SharedBuffer(size_t capacity) : _refs(1), _size(0), _capacity(capacity) {}
+
+SharedBuffer::~SharedBuffer(void) {}
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+char	*SharedBuffer::_bytes(void) { return (reinterpret_cast<char *>(this + 1)); }
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+const char	*SharedBuffer::data(void) const { return (reinterpret_cast<const char *>(this + 1)); }
+
+size_t	SharedBuffer::size(void) const { return (_size); }
+
+size_t	SharedBuffer::room(void) const { return (_capacity - _size); }
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/*
+** The returned buffer holds one reference, owned by the caller.
+*/
+SharedBuffer	*SharedBuffer::create(const char *data, size_t length)
+{
+	SharedBuffer	*buffer = create(length);
+	buffer->append(data, length);
+	return (buffer);
+}
+
+/*
+** An empty buffer with room for `capacity` bytes, one reference held by the
+** caller.
+*/
+SharedBuffer	*SharedBuffer::create(size_t capacity)
+{
+	void	*raw = ::operator new(sizeof(SharedBuffer) + capacity);
+	return (new (raw) SharedBuffer(capacity));
+}
+
+/* The caller checks room() first */
+void	SharedBuffer::append(const char *data, size_t length)
+{
+	std::memcpy(_bytes() + _size, data, length);
+	_size += length;
+}
+
+void	SharedBuffer::retain(void) { _refs++; }
+
+void	SharedBuffer::release(void)
+{
+	if (--_refs > 0)
+		return ;
+	this->~SharedBuffer();
+	::operator delete(this);
+}
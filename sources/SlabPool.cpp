@@ -0,0 +1,94 @@
+#include "../include/irc.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+/*
+** Blocks are rounded up to 16 bytes, enough alignment for anything the
+** pooled classes hold, and to fit the free list link.
+*/
+SlabPool::SlabPool(const char *name, size_t blockSize, size_t blocksPerSlab)
+	: _name(name), _blocksPerSlab(blocksPerSlab), _free(NULL), _live(0), _available(0)
+{
+	_blockSize = (std::max(blockSize, sizeof(FreeBlock)) + 15) & ~static_cast<size_t>(15);
+	_registry().push_back(this);
+}
+
+SlabPool::~SlabPool(void)
+{
+	std::vector<SlabPool *>	&registry = _registry();
+	registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+	for (size_t i = 0; i < _slabs.size(); i++)
+		::operator delete(_slabs[i]);
+}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+const char	*SlabPool::name(void) const { return (_name); }
+
+size_t	SlabPool::blockSize(void) const { return (_blockSize); }
+
+size_t	SlabPool::live(void) const { return (_live); }
+
+size_t	SlabPool::available(void) const { return (_available); }
+
+const std::vector<SlabPool *>	&SlabPool::pools(void) { return (_registry()); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+std::vector<SlabPool *>	&SlabPool::_registry(void)
+{
+	static std::vector<SlabPool *>	registry;
+	return (registry);
+}
+
+void	SlabPool::_addSlab(void)
+{
+	char	*slab = static_cast<char *>(::operator new(_blockSize * _blocksPerSlab));
+
+	_slabs.push_back(slab);
+	for (size_t i = _blocksPerSlab; i-- > 0; )
+	{
+		FreeBlock	*block = reinterpret_cast<FreeBlock *>(slab + i * _blockSize);
+		block->next = _free;
+		_free = block;
+	}
+	_available += _blocksPerSlab;
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+void	*SlabPool::allocate(void)
+{
+	if (!_free)
+		_addSlab();
+	FreeBlock	*block = _free;
+	_free = block->next;
+	_available--;
+	_live++;
+	return (block);
+}
+
+void	SlabPool::release(void *block)
+{
+	if (!block)
+		return ;
+	FreeBlock	*freed = static_cast<FreeBlock *>(block);
+	freed->next = _free;
+	_free = freed;
+	_available++;
+	_live--;
+}
+
+std::string	SlabPool::report(void) const
+{
+	return (std::string(_name) + " pool: " + sizeToString(_live) + " live, "
+		+ sizeToString(_available) + " free, " + sizeToString(_slabs.size()) + " slabs");
+}
@@ -0,0 +1,48 @@
+#include "../include/TokenBucket.hpp"
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+TokenBucket::TokenBucket(void) : _tokens(0), _rate(0), _burst(0), _refilled(0) {}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/* A new client starts with a full bucket */
+void	TokenBucket::setLimit(double rate, double burst, uint64_t now)
+{
+	_rate = rate;
+	_burst = burst < 1 ? 1 : burst;
+	_tokens = _burst;
+	_refilled = now;
+}
+
+bool	TokenBucket::available(uint64_t now)
+{
+	if (_rate <= 0)
+		return (true);
+	if (now > _refilled)
+	{
+		_tokens += (now - _refilled) * _rate / 1e9;
+		if (_tokens > _burst)
+			_tokens = _burst;
+		_refilled = now;
+	}
+	return (_tokens > 0);
+}
+
+void	TokenBucket::spend(double cost)
+{
+	if (_rate > 0)
+		_tokens -= cost;
+}
+
+/* Nanoseconds until the bucket is positive again, as of the last refill */
+uint64_t	TokenBucket::refillDelay(void) const
+{
+	if (_rate <= 0 || _tokens > 0)
+		return (0);
+	return (static_cast<uint64_t>((-_tokens / _rate) * 1e9) + 1);
+}
@@ -0,0 +1,633 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/*
+** ircbench: loopback load generator for ircserv.
+**
+**     ircbench [-p port] [-w password] [-s scenario] [-c clients]
+**              [-n channel size] [-m messages] [-S senders] [-x server binary]
+**              [-P server pid] [-o oper:password] [-h]
+**
+** Scenarios: register (connection and registration storm), churn (JOIN/PART
+** loops), fanout (PRIVMSG into one channel of N members), slow (fanout with
+** a quarter of the members never reading) or all. Without -p a server is
+** spawned from -x (./ircserv) on a free port and stopped at the end. Each
+** scenario prints one line: throughput, delivery latency percentiles and
+** the server's resident memory. With -o, the clients of the churn and
+** fan-out scenarios become IRC operators, who are not flood limited.
+*/
+
+struct Options
+{
+	int			port;
+	std::string	password;
+	std::string	scenario;
+	std::string	server;
+	std::string	oper;
+	size_t		clients;
+	size_t		channelSize;
+	size_t		messages;
+	size_t		senders;
+	pid_t		pid;
+};
+
+struct Conn
+{
+	int			fd;
+	size_t		id;
+	bool		connected;
+	bool		welcomed;
+	bool		reading;
+	size_t		pongs;
+	uint64_t	started;
+	std::string	in;
+	std::string	out;
+};
+
+struct Result
+{
+	std::string				name;
+	size_t					operations;
+	double					seconds;
+	std::vector<uint64_t>	latencies;
+};
+
+static uint64_t	nowNs(void)
+{
+	timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (static_cast<uint64_t>(now.tv_sec) * 1000000000u + now.tv_nsec);
+}
+
+static std::string	toString(size_t value)
+{
+	std::ostringstream	out;
+	out << value;
+	return (out.str());
+}
+
+// ************************************************************************** //
+//                                  Bench                                     //
+// ************************************************************************** //
+
+class Bench
+{
+	private:
+		const Options		&_options;
+		int					_epoll;
+		std::vector<Conn *>	_conns;
+		size_t				_welcomed;
+		size_t				_pongs;
+		size_t				_delivered;
+		size_t				_failed;
+		std::vector<uint64_t>	*_latencies;
+
+		Conn	*_open(size_t id);
+		void	_close(Conn *conn);
+		void	_send(Conn *conn, const std::string &line);
+		void	_flush(Conn *conn);
+		void	_read(Conn *conn);
+		void	_onLine(Conn *conn, const std::string &line);
+		void	_watch(Conn *conn);
+		void	_poll(int timeoutMs);
+		bool	_waitFor(size_t &counter, size_t target, int seconds);
+		void	_register(size_t count, std::vector<uint64_t> *latencies);
+		void	_closeAll(void);
+		Result	_fanout(const std::string &name, size_t slowMembers);
+
+	public:
+		Bench(const Options &options);
+		~Bench(void);
+
+		Result	registerStorm(void);
+		Result	churn(void);
+		Result	fanout(void);
+		Result	slowConsumers(void);
+};
+
+Bench::Bench(const Options &options)
+	: _options(options), _welcomed(0), _pongs(0), _delivered(0), _failed(0), _latencies(NULL)
+{
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+}
+
+Bench::~Bench(void)
+{
+	_closeAll();
+	close(_epoll);
+}
+
+Conn	*Bench::_open(size_t id)
+{
+	Conn		*conn = new Conn();
+	sockaddr_in	addr;
+
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(_options.port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	conn->id = id;
+	conn->connected = false;
+	conn->welcomed = false;
+	conn->reading = true;
+	conn->pongs = 0;
+	conn->started = nowNs();
+	if (conn->fd < 0 || (connect(conn->fd, (sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS))
+	{
+		if (conn->fd >= 0)
+			close(conn->fd);
+		delete conn;
+		_failed++;
+		return (NULL);
+	}
+	int	one = 1;
+	setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	epoll_event	event;
+	event.events = EPOLLIN | EPOLLOUT;
+	event.data.ptr = conn;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, conn->fd, &event);
+	_conns.push_back(conn);
+	return (conn);
+}
+
+void	Bench::_close(Conn *conn)
+{
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	conn->fd = -1;
+}
+
+void	Bench::_closeAll(void)
+{
+	for (size_t i = 0; i < _conns.size(); i++)
+	{
+		if (_conns[i]->fd >= 0)
+			_close(_conns[i]);
+		delete _conns[i];
+	}
+	_conns.clear();
+	_welcomed = 0;
+	_pongs = 0;
+	_delivered = 0;
+}
+
+/* Readable interest is dropped for a member playing a slow consumer */
+void	Bench::_watch(Conn *conn)
+{
+	epoll_event	event;
+
+	event.events = 0;
+	if (conn->reading)
+		event.events |= EPOLLIN;
+	if (!conn->out.empty() || !conn->connected)
+		event.events |= EPOLLOUT;
+	event.data.ptr = conn;
+	epoll_ctl(_epoll, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+void	Bench::_send(Conn *conn, const std::string &line)
+{
+	if (conn->fd < 0)
+		return ;
+
+	bool	idle = conn->out.empty();
+	conn->out += line;
+	conn->out += "\r\n";
+	if (idle && conn->connected)
+		_flush(conn);
+}
+
+void	Bench::_flush(Conn *conn)
+{
+	while (!conn->out.empty())
+	{
+		ssize_t	sent = ::send(conn->fd, conn->out.data(), conn->out.size(), MSG_NOSIGNAL);
+		if (sent <= 0)
+			break ;
+		conn->out.erase(0, sent);
+	}
+	_watch(conn);
+}
+
+void	Bench::_read(Conn *conn)
+{
+	char	buffer[65536];
+
+	while (true)
+	{
+		ssize_t	got = recv(conn->fd, buffer, sizeof(buffer), 0);
+		if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR))
+			return _close(conn);
+		if (got < 0)
+			break ;
+		conn->in.append(buffer, got);
+	}
+	size_t	start = 0;
+	size_t	end;
+	while ((end = conn->in.find("\r\n", start)) != std::string::npos)
+	{
+		_onLine(conn, conn->in.substr(start, end - start));
+		start = end + 2;
+	}
+	conn->in.erase(0, start);
+}
+
+/*
+** 001 completes a registration, PONG answers a PING (in order, the server
+** does not echo a token) and a PRIVMSG carrying "t=<ns>" was sent by one of
+** ours at that time.
+*/
+void	Bench::_onLine(Conn *conn, const std::string &line)
+{
+	size_t	space = line.find(' ');
+	if (space == std::string::npos)
+		return ;
+	std::string	command = line.substr(space + 1, line.find(' ', space + 1) - space - 1);
+
+	if (command == "001" && !conn->welcomed)
+	{
+		conn->welcomed = true;
+		_welcomed++;
+		if (_latencies)
+			_latencies->push_back(nowNs() - conn->started);
+	}
+	else if (line.compare(0, 5, "PONG ") == 0 || command == "PONG")
+	{
+		conn->pongs++;
+		_pongs++;
+	}
+	else if (command == "PRIVMSG")
+	{
+		size_t	stamp = line.rfind(" t=");
+		if (stamp == std::string::npos)
+			return ;
+		_delivered++;
+		if (_latencies)
+			_latencies->push_back(nowNs() - std::strtoull(line.c_str() + stamp + 3, NULL, 10));
+	}
+}
+
+void	Bench::_poll(int timeoutMs)
+{
+	epoll_event	events[256];
+	int			count = epoll_wait(_epoll, events, 256, timeoutMs);
+
+	for (int i = 0; i < count; i++)
+	{
+		Conn	*conn = static_cast<Conn *>(events[i].data.ptr);
+
+		if (conn->fd < 0)
+			continue ;
+		if (events[i].events & (EPOLLERR | EPOLLHUP))
+		{
+			_close(conn);
+			continue ;
+		}
+		if ((events[i].events & EPOLLOUT) && !conn->connected)
+			conn->connected = true;
+		if (events[i].events & EPOLLOUT)
+			_flush(conn);
+		if (events[i].events & EPOLLIN)
+			_read(conn);
+	}
+}
+
+bool	Bench::_waitFor(size_t &counter, size_t target, int seconds)
+{
+	uint64_t	deadline = nowNs() + static_cast<uint64_t>(seconds) * 1000000000u;
+
+	while (counter < target && nowNs() < deadline)
+		_poll(10);
+	return (counter >= target);
+}
+
+void	Bench::_register(size_t count, std::vector<uint64_t> *latencies)
+{
+	size_t	first = _conns.size();
+
+	_latencies = latencies;
+	for (size_t i = 0; i < count; i++)
+	{
+		Conn	*conn = _open(first + i);
+		if (!conn)
+			continue ;
+		std::string	nick = "b" + toString(conn->id);
+		_send(conn, "PASS " + _options.password);
+		_send(conn, "NICK " + nick);
+		_send(conn, "USER " + nick + " localhost bench :ircbench");
+		if (!latencies && !_options.oper.empty())
+			_send(conn, "OPER " + _options.oper);
+		if ((i + 1) % 256 == 0)
+			_poll(0);
+	}
+	_waitFor(_welcomed, count, 30);
+	_latencies = NULL;
+}
+
+/* Connect, PASS, NICK, USER until 001, all at once */
+Result	Bench::registerStorm(void)
+{
+	Result		result;
+	uint64_t	start = nowNs();
+
+	result.name = "register";
+	_register(_options.clients, &result.latencies);
+	result.seconds = (nowNs() - start) / 1e9;
+	result.operations = _welcomed;
+	_closeAll();
+	return (result);
+}
+
+/*
+** Every client joins and parts its own channel `messages` times, then sends
+** a PING; the round trip of each batch is a latency sample.
+*/
+Result	Bench::churn(void)
+{
+	Result		result;
+	size_t		rounds = std::max(_options.messages / 10, (size_t)1);
+	size_t		clients = std::min(_options.clients, (size_t)200);
+
+	result.name = "churn";
+	_register(clients, NULL);
+	uint64_t	start = nowNs();
+	for (size_t round = 0; round < rounds; round++)
+	{
+		uint64_t	sent = nowNs();
+		size_t		target = _pongs + _conns.size();
+		for (size_t i = 0; i < _conns.size(); i++)
+		{
+			std::string	channel = "#churn" + toString(i % 50);
+			for (size_t j = 0; j < 10; j++)
+			{
+				_send(_conns[i], "JOIN " + channel);
+				_send(_conns[i], "PART " + channel);
+			}
+			_send(_conns[i], "PING bench");
+		}
+		if (!_waitFor(_pongs, target, 30))
+			break ;
+		result.latencies.push_back(nowNs() - sent);
+	}
+	result.seconds = (nowNs() - start) / 1e9;
+	result.operations = rounds * 20 * _conns.size();
+	_closeAll();
+	return (result);
+}
+
+/*
+** channelSize members join one channel; `senders` of them send `messages`
+** lines each. Every delivery is timed from its send stamp.
+*/
+Result	Bench::_fanout(const std::string &name, size_t slowMembers)
+{
+	Result		result;
+	size_t		members = _options.channelSize;
+	size_t		senders = std::min(_options.senders, members);
+	std::string	channel = "#" + name;
+
+	result.name = name;
+	_register(members, NULL);
+	for (size_t i = 0; i < _conns.size(); i++)
+		_send(_conns[i], "JOIN " + channel);
+	for (size_t i = 0; i < _conns.size(); i++)
+		_send(_conns[i], "PING bench");
+	_waitFor(_pongs, _conns.size(), 30);
+	for (size_t i = 0; i < slowMembers && i + senders < _conns.size(); i++)
+	{
+		_conns[_conns.size() - 1 - i]->reading = false;
+		_watch(_conns[_conns.size() - 1 - i]);
+	}
+
+	size_t		healthy = _conns.size() - slowMembers - 1;
+	size_t		expected = senders * _options.messages * healthy;
+	uint64_t	start = nowNs();
+	_latencies = &result.latencies;
+	for (size_t m = 0; m < _options.messages; m++)
+	{
+		for (size_t s = 0; s < senders; s++)
+			_send(_conns[s], "PRIVMSG " + channel + " :load t=" + toString(nowNs()));
+		_poll(0);
+	}
+	_waitFor(_delivered, expected, 60);
+	_latencies = NULL;
+	result.seconds = (nowNs() - start) / 1e9;
+	result.operations = _delivered;
+	_closeAll();
+	return (result);
+}
+
+Result	Bench::fanout(void) { return (_fanout("fanout", 0)); }
+
+Result	Bench::slowConsumers(void) { return (_fanout("slow", _options.channelSize / 4)); }
+
+// ************************************************************************** //
+//                                 Reporting                                  //
+// ************************************************************************** //
+
+static size_t	residentKb(pid_t pid)
+{
+	std::ifstream	status(("/proc/" + toString(pid) + "/status").c_str());
+	std::string		line;
+
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, 6, "VmRSS:") == 0)
+			return (std::strtoul(line.c_str() + 6, NULL, 10));
+	}
+	return (0);
+}
+
+static double	percentileUs(std::vector<uint64_t> &samples, double quantile)
+{
+	if (samples.empty())
+		return (0);
+	size_t	rank = static_cast<size_t>(quantile * (samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+	return (samples[rank] / 1000.0);
+}
+
+static void	report(Result result, pid_t pid)
+{
+	std::printf("%-9s ops %-9zu %8.2fs %12.0f ops/s  latency us p50 %9.1f p99 %9.1f p999 %9.1f max %9.1f  rss %zu KB\n",
+		result.name.c_str(), result.operations, result.seconds,
+		result.seconds > 0 ? result.operations / result.seconds : 0,
+		percentileUs(result.latencies, 0.5), percentileUs(result.latencies, 0.99),
+		percentileUs(result.latencies, 0.999), percentileUs(result.latencies, 1.0),
+		pid > 0 ? residentKb(pid) : (size_t)0);
+	std::fflush(stdout);
+}
+
+// ************************************************************************** //
+//                                   Main                                     //
+// ************************************************************************** //
+
+static bool	serverUp(int port)
+{
+	int			fd = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in	addr;
+
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bool	up = connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0;
+	close(fd);
+	return (up);
+}
+
+/* Picks a free port from the kernel, then starts the server on it */
+static pid_t	spawnServer(Options &options)
+{
+	int			fd = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in	addr;
+	socklen_t	length = sizeof(addr);
+
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(fd, (sockaddr *)&addr, sizeof(addr));
+	getsockname(fd, (sockaddr *)&addr, &length);
+	options.port = ntohs(addr.sin_port);
+	close(fd);
+
+	pid_t	pid = fork();
+	if (pid == 0)
+	{
+		int	null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		dup2(null, STDERR_FILENO);
+		std::string	port = toString(options.port);
+		execl(options.server.c_str(), options.server.c_str(), port.c_str(), options.password.c_str(), (char *)NULL);
+		_exit(127);
+	}
+	for (int tries = 0; tries < 100 && !serverUp(options.port); tries++)
+		usleep(20000);
+	return (pid);
+}
+
+static void	usage(std::ostream &out)
+{
+	out << "usage: ircbench [-p port] [-w password] [-s register|churn|fanout|slow|all]"
+		" [-c clients] [-n channel size] [-m messages] [-S senders] [-x server] [-P server pid]"
+		" [-o oper:password] [-h]" << std::endl;
+}
+
+static bool	parseOptions(int ac, char **av, Options &options)
+{
+	int	opt;
+
+	options.port = 0;
+	options.password = "bench";
+	options.scenario = "all";
+	options.server = "./ircserv";
+	options.clients = 1000;
+	options.channelSize = 500;
+	options.messages = 200;
+	options.senders = 5;
+	options.pid = 0;
+	while ((opt = getopt(ac, av, "p:w:s:c:n:m:S:x:P:o:h")) != -1)
+	{
+		if (opt == 'p')
+			options.port = std::atoi(optarg);
+		else if (opt == 'w')
+			options.password = optarg;
+		else if (opt == 's')
+			options.scenario = optarg;
+		else if (opt == 'c')
+			options.clients = std::strtoul(optarg, NULL, 10);
+		else if (opt == 'n')
+			options.channelSize = std::max(std::strtoul(optarg, NULL, 10), 2ul);
+		else if (opt == 'm')
+			options.messages = std::strtoul(optarg, NULL, 10);
+		else if (opt == 'S')
+			options.senders = std::max(std::strtoul(optarg, NULL, 10), 1ul);
+		else if (opt == 'x')
+			options.server = optarg;
+		else if (opt == 'P')
+			options.pid = std::atoi(optarg);
+		else if (opt == 'o')
+		{
+			options.oper = optarg;
+			if (options.oper.find(':') != std::string::npos)
+				options.oper[options.oper.find(':')] = ' ';
+		}
+		else if (opt == 'h')
+		{
+			usage(std::cout);
+			std::exit(0);
+		}
+		else
+			return (false);
+	}
+	return (true);
+}
+
+int	main(int ac, char **av)
+{
+	Options	options;
+
+	if (!parseOptions(ac, av, options))
+	{
+		usage(std::cerr);
+		return (1);
+	}
+	rlimit	limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	bool	spawned = options.port == 0;
+	if (spawned)
+		options.pid = spawnServer(options);
+	if (!serverUp(options.port))
+	{
+		std::cerr << "ircbench: no server on port " << options.port << std::endl;
+		return (1);
+	}
+
+	Bench		bench(options);
+	std::string	scenario = options.scenario;
+	bool		all = scenario == "all";
+
+	if (all || scenario == "register")
+		report(bench.registerStorm(), options.pid);
+	if (all || scenario == "churn")
+		report(bench.churn(), options.pid);
+	if (all || scenario == "fanout")
+		report(bench.fanout(), options.pid);
+	if (all || scenario == "slow")
+		report(bench.slowConsumers(), options.pid);
+
+	if (spawned && options.pid > 0)
+	{
+		kill(options.pid, SIGINT);
+		waitpid(options.pid, NULL, 0);
+	}
+	return (0);
+}
@@ -0,0 +1,158 @@
+#include "../../include/LogFormat.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdint.h>
+
+/*
+** logdecode [file...]: prints the binary log written with log_binary_file
+** (stdin without arguments) as the text the server would have logged.
+*/
+
+typedef std::map<uint32_t, std::string>	formats_t;
+
+static const char	*levels[] = { "INFO", "WARNING", "ERROR" };
+
+class Reader
+{
+	private:
+		const std::vector<char>	&_data;
+		size_t					_pos;
+
+	public:
+		Reader(const std::vector<char> &data) : _data(data), _pos(0) {}
+
+		bool	done(void) const { return (_pos >= _data.size()); }
+		size_t	pos(void) const { return (_pos); }
+
+		bool	get(void *out, size_t length)
+		{
+			if (_data.size() - _pos < length)
+				return (false);
+			std::memcpy(out, &_data[_pos], length);
+			_pos += length;
+			return (true);
+		}
+
+		bool	bytes(std::string &out, size_t length)
+		{
+			if (_data.size() - _pos < length)
+				return (false);
+			out.assign(&_data[_pos], length);
+			_pos += length;
+			return (true);
+		}
+
+		bool	magic(void)
+		{
+			if (_data.size() - _pos < LOG_FILE_MAGIC_SIZE
+				|| std::memcmp(&_data[_pos], LOG_FILE_MAGIC, LOG_FILE_MAGIC_SIZE) != 0)
+				return (false);
+			_pos += LOG_FILE_MAGIC_SIZE;
+			return (true);
+		}
+};
+
+static void	printLine(int64_t time, uint8_t level, const char *text, size_t length)
+{
+	std::time_t	when = time;
+	std::tm		local;
+	char		stamp[32];
+
+	localtime_r(&when, &local);
+	std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+	std::cout << stamp << " [" << (level < 3 ? levels[level] : "?") << "] ";
+	std::cout.write(text, length);
+	std::cout << '\n';
+}
+
+/* One record after its tag; false when the file is cut or corrupt */
+static bool	decodeRecord(Reader &in, char tag, formats_t &formats)
+{
+	uint8_t		level;
+	uint32_t	id;
+	int64_t		time;
+	uint16_t	length;
+	std::string	bytes;
+
+	if (tag == LOG_RECORD_FORMAT)
+	{
+		if (!in.get(&id, sizeof(id)) || !in.get(&length, sizeof(length)) || !in.bytes(bytes, length))
+			return (false);
+		formats[id] = bytes;
+		return (true);
+	}
+	if (tag == LOG_RECORD_TEXT)
+	{
+		if (!in.get(&level, sizeof(level)) || !in.get(&time, sizeof(time))
+			|| !in.get(&length, sizeof(length)) || !in.bytes(bytes, length))
+			return (false);
+		printLine(time, level, bytes.data(), bytes.size());
+		return (true);
+	}
+	if (tag == LOG_RECORD_EVENT)
+	{
+		if (!in.get(&level, sizeof(level)) || !in.get(&id, sizeof(id)) || !in.get(&time, sizeof(time))
+			|| !in.get(&length, sizeof(length)) || !in.bytes(bytes, length))
+			return (false);
+		formats_t::const_iterator	format = formats.find(id);
+		if (format == formats.end())
+			return (std::cerr << "logdecode: unknown format id " << id << std::endl, false);
+		char	text[2 * LOG_TEXT_MAX];
+		size_t	used = renderLog(format->second.c_str(), bytes.data(), bytes.size(), text, sizeof(text));
+		printLine(time, level, text, used);
+		return (true);
+	}
+	return (false);
+}
+
+static int	decode(std::istream &stream, const char *name)
+{
+	std::vector<char>	data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	Reader				in(data);
+	formats_t			formats;
+	char				tag;
+
+	if (!in.magic())
+		return (std::cerr << "logdecode: " << name << ": not a binary log" << std::endl, 1);
+	while (!in.done())
+	{
+		if (in.magic())
+		{
+			formats.clear();
+			continue ;
+		}
+		size_t	start = in.pos();
+		if (!in.get(&tag, 1) || !decodeRecord(in, tag, formats))
+		{
+			std::cerr << "logdecode: " << name << ": bad record at offset " << start << std::endl;
+			return (1);
+		}
+	}
+	return (0);
+}
+
+int	main(int ac, char **av)
+{
+	int	status = 0;
+
+	if (ac < 2)
+		return (decode(std::cin, "stdin"));
+	for (int i = 1; i < ac; i++)
+	{
+		std::ifstream	file(av[i], std::ios::binary);
+		if (!file)
+		{
+			std::cerr << "logdecode: cannot open " << av[i] << std::endl;
+			status = 1;
+			continue ;
+		}
+		status |= decode(file, av[i]);
+	}
+	return (status);
+}
@@ -0,0 +1,361 @@
+#include "../../include/irc.hpp"
+#include <cstdio>
+#include <new>
+
+/*
+** ircmicro: microbenchmarks for the server's hot functions, linked against
+** the server objects and run in isolation, without sockets.
+**
+**     ircmicro [filter]
+**
+** Each case is calibrated until one run takes at least 100ms, then timed
+** once more. Results go to stdout as JSON, one object per case with ns/op
+** and allocs/op; the allocations are the calling thread's global operator
+** new calls (slab pool blocks are not counted, the slabs themselves are).
+** The server's own log output is sent to /dev/null. Only cases whose name
+** contains the filter are run.
+*/
+
+#define MICRO_MIN_NS 100000000u
+#define MICRO_FLUSH_EVERY 64
+
+static __thread size_t	g_allocs = 0;
+
+void	*operator new(size_t size) throw(std::bad_alloc)
+{
+	void	*block = std::malloc(size ? size : 1);
+
+	if (!block)
+		throw std::bad_alloc();
+	g_allocs++;
+	return (block);
+}
+
+void	*operator new[](size_t size) throw(std::bad_alloc) { return (operator new(size)); }
+
+void	operator delete(void *block) throw() { std::free(block); }
+
+void	operator delete[](void *block) throw() { std::free(block); }
+
+/* Benchmarked values end up here so the calls cannot be optimised away */
+static volatile size_t	g_sink = 0;
+
+struct Fixture
+{
+	Server						*server;
+	EventLoop					*loop;
+	ChannelManager				*manager;
+	std::vector<Client *>		clients;
+	std::vector<std::string>	channelNames;
+	Channel						*channel;
+};
+
+static Fixture	g_fixture;
+
+/* A case runs `iterations` operations and returns the time not to count */
+typedef uint64_t	(*case_fn)(size_t iterations, size_t size);
+
+struct Case
+{
+	const char	*name;
+	case_fn		run;
+	size_t		size;
+};
+
+struct Result
+{
+	size_t		iterations;
+	uint64_t	ns;
+	size_t		allocs;
+};
+
+// ************************************************************************** //
+//                                 Fixture                                    //
+// ************************************************************************** //
+
+static std::string	nickFor(size_t i) { return ("nick" + sizeToString(i)); }
+
+/* Clients are indexed by nickname but never watched, they have no socket */
+static void	addClients(size_t count)
+{
+	pollfd	socket;
+
+	socket.fd = -1;
+	socket.events = POLLIN;
+	socket.revents = 0;
+	while (g_fixture.clients.size() < count)
+	{
+		Client		*client = new Client(socket, MAX_LINE_LENGTH);
+		std::string	nickname = nickFor(g_fixture.clients.size());
+		std::string	username = "user";
+		std::string	hostname = "127.0.0.1";
+
+		client->setLoop(g_fixture.loop);
+		client->setUsername(username);
+		client->setHostname(hostname);
+		client->setRegistered(true);
+		g_fixture.server->renameClient(*client, nickname);
+		g_fixture.clients.push_back(client);
+	}
+}
+
+static void	addChannels(size_t count)
+{
+	while (g_fixture.channelNames.size() < count)
+	{
+		std::string	name = "#chan" + sizeToString(g_fixture.channelNames.size());
+
+		g_fixture.manager->createChannel(name);
+		g_fixture.channelNames.push_back(name);
+	}
+}
+
+/* The sink: queued lines are dropped, nothing is ever written */
+static uint64_t	drainQueues(size_t members)
+{
+	uint64_t	start = monotonicNs();
+
+	for (size_t i = 0; i < members; i++)
+		g_fixture.clients[i]->getSendQueue().clear();
+	return (monotonicNs() - start);
+}
+
+static void	resetChannel(size_t members)
+{
+	delete g_fixture.channel;
+	g_fixture.channel = new Channel("#fanout");
+	addClients(members);
+	for (size_t i = 0; i < members; i++)
+		g_fixture.channel->addMember(g_fixture.clients[i], 0);
+}
+
+static void	teardown(void)
+{
+	delete g_fixture.channel;
+	delete g_fixture.manager;
+	for (size_t i = 0; i < g_fixture.clients.size(); i++)
+		delete g_fixture.clients[i];
+	delete g_fixture.loop;
+	delete g_fixture.server;
+}
+
+// ************************************************************************** //
+//                                  Cases                                     //
+// ************************************************************************** //
+
+static uint64_t	benchSplit(size_t iterations, size_t size)
+{
+	std::string	list = "#ft_irc,#general,#random,#help";
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += split(list, ',').size();
+	return (0);
+}
+
+static uint64_t	benchParse(size_t iterations, size_t size)
+{
+	const char	*line = ":nick!user@host PRIVMSG #ft_irc :hello there, everyone";
+	StringView	view(line, std::strlen(line));
+	IrcMessage	msg;
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += msg.parse(view);
+	return (0);
+}
+
+static uint64_t	benchFindCommand(size_t iterations, size_t size)
+{
+	const StringView	tokens[] = {
+		StringView("PRIVMSG", 7), StringView("join", 4), StringView("PING", 4), StringView("FOO", 3)};
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += findCommand(tokens[i & 3]) != NULL;
+	return (0);
+}
+
+static uint64_t	benchReplyNumeric(size_t iterations, size_t size)
+{
+	Client	&client = *g_fixture.clients[0];
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += (ERR_NEEDMOREPARAMS(client, "JOIN")).size();
+	return (0);
+}
+
+static uint64_t	benchReplyWelcome(size_t iterations, size_t size)
+{
+	Client	&client = *g_fixture.clients[0];
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += (RPL_WELCOME(client)).size();
+	return (0);
+}
+
+static uint64_t	benchReplyPrivmsg(size_t iterations, size_t size)
+{
+	Client		&client = *g_fixture.clients[0];
+	std::string	channel = "#ft_irc";
+	std::string	message = "hello there, everyone";
+
+	(void)size;
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += (PRIVMSG(client, channel, message)).size();
+	return (0);
+}
+
+static uint64_t	benchBroadcast(size_t iterations, size_t members)
+{
+	Client		&client = *g_fixture.clients[0];
+	Reply		line = PRIVMSG(client, "#fanout", "hello there, everyone");
+	uint64_t	excluded = 0;
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		g_fixture.channel->broadcast(line);
+		if (i % MICRO_FLUSH_EVERY == MICRO_FLUSH_EVERY - 1)
+			excluded += drainQueues(members);
+	}
+	return (excluded + drainQueues(members));
+}
+
+static uint64_t	benchClientByNick(size_t iterations, size_t clients)
+{
+	std::vector<std::string>	names;
+
+	for (size_t i = 0; i < 64; i++)
+		names.push_back(nickFor((i * 7919) % clients));
+	names[63] = "nobody";
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += g_fixture.server->getClientByNick(names[i & 63]) != NULL;
+	return (0);
+}
+
+static uint64_t	benchChanByName(size_t iterations, size_t channels)
+{
+	std::vector<std::string>	names;
+
+	for (size_t i = 0; i < 64; i++)
+		names.push_back(g_fixture.channelNames[(i * 7919) % channels]);
+	names[63] = "#nowhere";
+	for (size_t i = 0; i < iterations; i++)
+		g_sink += g_fixture.manager->getChanByName(names[i & 63]) != NULL;
+	return (0);
+}
+
+static const Case	g_cases[] = {
+	{"split", &benchSplit, 0},
+	{"IrcMessage::parse", &benchParse, 0},
+	{"findCommand", &benchFindCommand, 0},
+	{"ERR_NEEDMOREPARAMS", &benchReplyNumeric, 0},
+	{"RPL_WELCOME", &benchReplyWelcome, 0},
+	{"PRIVMSG", &benchReplyPrivmsg, 0},
+	{"Channel::broadcast/1", &benchBroadcast, 1},
+	{"Channel::broadcast/10", &benchBroadcast, 10},
+	{"Channel::broadcast/100", &benchBroadcast, 100},
+	{"Channel::broadcast/1000", &benchBroadcast, 1000},
+	{"Server::getClientByNick/100", &benchClientByNick, 100},
+	{"Server::getClientByNick/1000", &benchClientByNick, 1000},
+	{"Server::getClientByNick/10000", &benchClientByNick, 10000},
+	{"ChannelManager::getChanByName/100", &benchChanByName, 100},
+	{"ChannelManager::getChanByName/1000", &benchChanByName, 1000},
+	{"ChannelManager::getChanByName/10000", &benchChanByName, 10000},
+};
+
+// ************************************************************************** //
+//                                  Runner                                    //
+// ************************************************************************** //
+
+static Result	measure(const Case &bench, size_t iterations)
+{
+	Result		result;
+	size_t		allocs = g_allocs;
+	uint64_t	start = monotonicNs();
+	uint64_t	excluded = bench.run(iterations, bench.size);
+
+	result.ns = monotonicNs() - start - excluded;
+	result.allocs = g_allocs - allocs;
+	result.iterations = iterations;
+	return (result);
+}
+
+/* Doubles the iteration count until a run is long enough, then times it */
+static Result	calibrate(const Case &bench)
+{
+	size_t	iterations = 1;
+	Result	result = measure(bench, iterations);
+
+	while (result.ns < MICRO_MIN_NS && iterations < ((size_t)1 << 40))
+	{
+		if (result.ns < MICRO_MIN_NS / 64)
+			iterations *= 8;
+		else
+			iterations *= 2;
+		result = measure(bench, iterations);
+	}
+	return (measure(bench, iterations));
+}
+
+static void	prepare(const Case &bench)
+{
+	if (bench.run == &benchBroadcast)
+		resetChannel(bench.size);
+	else if (bench.run == &benchClientByNick)
+		addClients(bench.size);
+	else if (bench.run == &benchChanByName)
+		addChannels(bench.size);
+}
+
+/* The server logs through stdout; the report gets a descriptor of its own */
+static FILE	*openReport(void)
+{
+	int		out = dup(STDOUT_FILENO);
+	int		null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+	if (out < 0 || null < 0)
+		return (NULL);
+	dup2(null, STDOUT_FILENO);
+	close(null);
+	return (fdopen(out, "w"));
+}
+
+int	main(int ac, char **av)
+{
+	std::string	filter = ac > 1 ? av[1] : "";
+	std::string	password = "bench";
+	FILE		*report = openReport();
+	bool		first = true;
+
+	if (!report)
+		return (perror("ircmicro"), 1);
+	signal(SIGPIPE, SIG_IGN);
+	g_fixture.server = new Server(0, password);
+	g_fixture.loop = new EventLoop(*g_fixture.server, 0, 0, false);
+	g_fixture.manager = new ChannelManager(*g_fixture.server);
+	g_fixture.channel = NULL;
+	addClients(1);
+
+	std::fprintf(report, "{\"benchmarks\": [\n");
+	for (size_t i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++)
+	{
+		if (std::string(g_cases[i].name).find(filter) == std::string::npos)
+			continue ;
+		prepare(g_cases[i]);
+
+		Result	result = calibrate(g_cases[i]);
+
+		std::fprintf(report, "%s  {\"name\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f}",
+			first ? "" : ",\n", g_cases[i].name, (unsigned long)result.iterations,
+			(double)result.ns / result.iterations, (double)result.allocs / result.iterations);
+		std::fflush(report);
+		first = false;
+	}
+	std::fprintf(report, "\n]}\n");
+	std::fclose(report);
+	teardown();
+	return (0);
+}
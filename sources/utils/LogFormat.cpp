@@ -0,0 +1,146 @@
+#include "../../include/LogFormat.hpp"
+#include <cstring>
+#include <cstdio>
+#include <stdint.h>
+
+// ************************************************************************** //
+//                       Constructors & Desctructors                          //
+// ************************************************************************** //
+
+LogArgs::LogArgs(void) : _size(0) {}
+
+// ************************************************************************** //
+//                               Accessors                                    //
+// ************************************************************************** //
+
+const char	*LogArgs::data(void) const { return (_data); }
+
+size_t	LogArgs::size(void) const { return (_size); }
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+void	LogArgs::_put(char tag, const void *value, size_t length)
+{
+	if (_size + 1 + length > sizeof(_data))
+		return ;
+	_data[_size] = tag;
+	std::memcpy(_data + _size + 1, value, length);
+	_size += 1 + length;
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+LogArgs	&LogArgs::operator<<(int value) { return (*this << static_cast<long>(value)); }
+
+LogArgs	&LogArgs::operator<<(unsigned int value) { return (*this << static_cast<unsigned long>(value)); }
+
+LogArgs	&LogArgs::operator<<(long value)
+{
+	int64_t	encoded = value;
+	_put(LOG_ARG_INT, &encoded, sizeof(encoded));
+	return (*this);
+}
+
+LogArgs	&LogArgs::operator<<(unsigned long value)
+{
+	uint64_t	encoded = value;
+	_put(LOG_ARG_UINT, &encoded, sizeof(encoded));
+	return (*this);
+}
+
+LogArgs	&LogArgs::operator<<(const char *text)
+{
+	size_t	length = std::strlen(text);
+	char	encoded[LOG_TEXT_MAX];
+	size_t	room = sizeof(_data) - _size;
+
+	if (room < 3)
+		return (*this);
+	if (length > room - 3)
+		length = room - 3;
+	uint16_t	size = length;
+	std::memcpy(encoded, &size, sizeof(size));
+	std::memcpy(encoded + sizeof(size), text, length);
+	_put(LOG_ARG_STRING, encoded, sizeof(size) + length);
+	return (*this);
+}
+
+LogArgs	&LogArgs::operator<<(const std::string &text) { return (*this << text.c_str()); }
+
+/* Bytes after the tag of the argument at `arg`, or more than `left` if cut */
+static size_t	_argSize(const char *arg, size_t left)
+{
+	uint16_t	size;
+
+	if (arg[0] == LOG_ARG_INT || arg[0] == LOG_ARG_UINT)
+		return (sizeof(int64_t));
+	if (arg[0] != LOG_ARG_STRING || left < 1 + sizeof(size))
+		return (left);
+	std::memcpy(&size, arg + 1, sizeof(size));
+	return (sizeof(size) + size);
+}
+
+/*
+** Fills each printf conversion of `format` with the next encoded argument,
+** printed according to its own tag whatever the conversion letter says.
+** Missing or truncated arguments print as "?". Returns the rendered length.
+*/
+size_t	renderLog(const char *format, const char *args, size_t length, char *out, size_t room)
+{
+	size_t	used = 0;
+	size_t	read = 0;
+
+	for (const char *c = format; *c && used < room; c++)
+	{
+		if (*c != '%' || c[1] == '%')
+		{
+			out[used++] = *c;
+			c += (*c == '%');
+			continue ;
+		}
+		while (c[1] && std::strchr("-+ #0123456789.hlzjt", c[1]))
+			c++;
+		if (c[1])
+			c++;
+
+		char	text[32];
+		size_t	textLength = 0;
+		const char	*value = text;
+		if (read >= length || read + 1 + _argSize(args + read, length - read) > length)
+		{
+			textLength = std::snprintf(text, sizeof(text), "?");
+			read = length;
+		}
+		else if (args[read] == LOG_ARG_INT)
+		{
+			int64_t	number;
+			std::memcpy(&number, args + read + 1, sizeof(number));
+			textLength = std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(number));
+			read += 1 + sizeof(number);
+		}
+		else if (args[read] == LOG_ARG_UINT)
+		{
+			uint64_t	number;
+			std::memcpy(&number, args + read + 1, sizeof(number));
+			textLength = std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(number));
+			read += 1 + sizeof(number);
+		}
+		else
+		{
+			uint16_t	size;
+			std::memcpy(&size, args + read + 1, sizeof(size));
+			value = args + read + 1 + sizeof(size);
+			textLength = size;
+			read += 1 + sizeof(size) + size;
+		}
+		if (textLength > room - used)
+			textLength = room - used;
+		std::memcpy(out + used, value, textLength);
+		used += textLength;
+	}
+	return (used);
+}
@@ -1,16 +1,391 @@
 #include "../../include/irc.hpp"
 
+// ************************************************************************** //
+//                             Static Variables                               //
+// ************************************************************************** //
+
+Logger::Record	*Logger::_ring = NULL;
+size_t			Logger::_mask = 0;
+size_t			Logger::_head = 0;
+size_t			Logger::_tail = 0;
+bool			Logger::_block = false;
+bool			Logger::_running = false;
+size_t			Logger::_dropped = 0;
+std::time_t		Logger::_now = 0;
+int				Logger::_binaryFd = -1;
+pthread_t		Logger::_writer;
+pthread_mutex_t	Logger::_produce = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t	Logger::_wake = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t	Logger::_notEmpty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t	Logger::_notFull = PTHREAD_COND_INITIALIZER;
+bool			Logger::_writerIdle = false;
+bool			Logger::_producerBlocked = false;
+
+// ************************************************************************** //
+//                             Private Functions                              //
+// ************************************************************************** //
+
+static char	*append(char *out, const char *text)
+{
+	size_t	length = std::strlen(text);
+	std::memcpy(out, text, length);
+	return (out + length);
+}
+
+void	Logger::_stamp(std::time_t time, char *stamp)
+{
+	std::tm	local;
+
+	localtime_r(&time, &local);
+	std::strftime(stamp, LOG_STAMP_SIZE, "%Y-%m-%d %H:%M:%S", &local);
+}
+
+/*
+** "<colour><stamp> [LEVEL] message<reset>\n", the message rendered from its
+** format and arguments first for a deferred record.
+*/
+size_t	Logger::_format(char *out, const Record &record, const char *stamp)
+{
+	static const char	*colours[] = { GREEN, YELLOW, RED };
+	static const char	*labels[] = { " [INFO] ", " [WARNING] ", " [ERROR] " };
+	char				*end = out;
+
+	end = append(end, colours[record.level]);
+	end = append(end, stamp);
+	end = append(end, labels[record.level]);
+	if (record.format)
+		end += renderLog(record.format, record.text, record.length, end, LOG_TEXT_MAX);
+	else
+	{
+		std::memcpy(end, record.text, record.length);
+		end += record.length;
+	}
+	end = append(end, RESET);
+	*end++ = '\n';
+	return (end - out);
+}
+
+static char	*put(char *out, const void *value, size_t length)
+{
+	std::memcpy(out, value, length);
+	return (out + length);
+}
+
+/*
+** Binary form of a record (LogFormat.hpp). A format string is written the
+** first time the writer meets it and referred to by id afterwards.
+*/
+size_t	Logger::_encode(char *out, const Record &record, formats_t &formats)
+{
+	char		*end = out;
+	uint8_t		level = record.level;
+	int64_t		time = record.time;
+	uint16_t	length = record.length;
+
+	if (!record.format)
+	{
+		*end++ = LOG_RECORD_TEXT;
+		end = put(end, &level, sizeof(level));
+		end = put(end, &time, sizeof(time));
+		end = put(end, &length, sizeof(length));
+		return (put(end, record.text, length) - out);
+	}
+	formats_t::iterator	it = formats.find(record.format);
+	if (it == formats.end())
+	{
+		uint32_t	id = formats.size() + 1;
+		uint16_t	formatLength = std::min(std::strlen(record.format), (size_t)LOG_TEXT_MAX);
+
+		it = formats.insert(std::make_pair(record.format, id)).first;
+		*end++ = LOG_RECORD_FORMAT;
+		end = put(end, &id, sizeof(id));
+		end = put(end, &formatLength, sizeof(formatLength));
+		end = put(end, record.format, formatLength);
+	}
+	uint32_t	id = it->second;
+	*end++ = LOG_RECORD_EVENT;
+	end = put(end, &level, sizeof(level));
+	end = put(end, &id, sizeof(id));
+	end = put(end, &time, sizeof(time));
+	end = put(end, &length, sizeof(length));
+	return (put(end, record.text, length) - out);
+}
+
+void	Logger::_fill(Record &record, std::time_t time, LogLevel level,
+	const char *format, const char *data, size_t length)
+{
+	record.time = time;
+	record.level = level;
+	record.format = format;
+	record.length = std::min(length, (size_t)LOG_TEXT_MAX);
+	std::memcpy(record.text, data, record.length);
+}
+
+void	Logger::_write(int fd, const char *data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t	written = ::write(fd, data, length);
+		if (written < 0 && errno == EINTR)
+			continue ;
+		if (written <= 0)
+			return ;
+		data += written;
+		length -= written;
+	}
+}
+
+void	Logger::_writeNow(LogLevel level, const char *format, const char *data, size_t length)
+{
+	Record	record;
+	char	stamp[LOG_STAMP_SIZE];
+	char	line[LOG_LINE_MAX];
+
+	_fill(record, std::time(0), level, format, data, length);
+	_stamp(record.time, stamp);
+	_write(level == LOG_ERROR ? STDERR_FILENO : STDOUT_FILENO, line, _format(line, record, stamp));
+}
+
+/* Wakes the other side of the ring if it said it is going to sleep */
+void	Logger::_signal(bool &waiting, pthread_cond_t &cond)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&waiting, __ATOMIC_RELAXED))
+		return ;
+	pthread_mutex_lock(&_wake);
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&_wake);
+}
+
+static void	deadlineIn(long ms, timespec &deadline)
+{
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+}
+
+/*
+** The flag is raised before the ring is checked again, and producers check
+** the flag after publishing, so one of the two always sees the other. The
+** timeout only bounds how late a dropped-messages warning can be.
+*/
+void	Logger::_waitWriter(void)
+{
+	timespec	deadline;
+
+	deadlineIn(100, deadline);
+	pthread_mutex_lock(&_wake);
+	__atomic_store_n(&_writerIdle, true, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&_head, __ATOMIC_SEQ_CST) == _tail && __atomic_load_n(&_running, __ATOMIC_SEQ_CST))
+		pthread_cond_timedwait(&_notEmpty, &_wake, &deadline);
+	__atomic_store_n(&_writerIdle, false, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&_wake);
+}
+
+/* Same handshake the other way round, for a producer facing a full ring */
+void	Logger::_waitRoom(size_t head)
+{
+	pthread_mutex_lock(&_wake);
+	__atomic_store_n(&_producerBlocked, true, __ATOMIC_SEQ_CST);
+	if (head - __atomic_load_n(&_tail, __ATOMIC_SEQ_CST) > _mask)
+		pthread_cond_wait(&_notFull, &_wake);
+	__atomic_store_n(&_producerBlocked, false, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&_wake);
+}
+
+/*
+** Drains the ring into a batch buffer, one write per output stream per
+** batch. Errors go to stderr, the rest to stdout, in ring order, unless
+** everything goes to the binary log. The stamp is only reformatted when the
+** second changes. Sleeps until a record arrives when there is nothing to
+** write.
+*/
+void	*Logger::_writerMain(void *unused)
+{
+	static char	batch[LOG_OUTPUT_SIZE];
+	size_t		used = 0;
+	int			batchFd = STDOUT_FILENO;
+	char		stamp[LOG_STAMP_SIZE];
+	std::time_t	stampTime = -1;
+	formats_t	formats;
+	size_t		reported = 0;
+
+	(void)unused;
+	while (true)
+	{
+		size_t	first = _tail;
+		size_t	tail = first;
+		size_t	head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+		bool	running = __atomic_load_n(&_running, __ATOMIC_ACQUIRE);
+
+		for (; tail != head; tail++)
+		{
+			const Record	&record = _ring[tail & _mask];
+			int				fd = record.level == LOG_ERROR ? STDERR_FILENO : STDOUT_FILENO;
+
+			if (_binaryFd >= 0)
+				fd = _binaryFd;
+			if (used > 0 && (fd != batchFd || used + LOG_RECORD_MAX > sizeof(batch)))
+			{
+				_write(batchFd, batch, used);
+				used = 0;
+			}
+			batchFd = fd;
+			if (_binaryFd >= 0)
+			{
+				used += _encode(batch + used, record, formats);
+				__atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+				continue ;
+			}
+			if (record.time != stampTime)
+			{
+				_stamp(record.time, stamp);
+				stampTime = record.time;
+			}
+			used += _format(batch + used, record, stamp);
+			__atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+		}
+		if (used > 0)
+		{
+			_write(batchFd, batch, used);
+			used = 0;
+		}
+		if (tail != first)
+			_signal(_producerBlocked, _notFull);
+		size_t	dropped = __atomic_load_n(&_dropped, __ATOMIC_RELAXED);
+		if (dropped != reported)
+		{
+			LogArgs	args;
+			args << dropped - reported;
+			_writeNow(LOG_WARNING, "%zu log messages dropped (log ring full)", args.data(), args.size());
+			reported = dropped;
+		}
+		if (!running && tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+			break ;
+		if (tail == first)
+			_waitWriter();
+	}
+	return (NULL);
+}
+
+void	Logger::_push(LogLevel level, const char *format, const char *data, size_t length)
+{
+	pthread_mutex_lock(&_produce);
+	if (!_running)
+	{
+		pthread_mutex_unlock(&_produce);
+		return _writeNow(level, format, data, length);
+	}
+	size_t	head = _head;
+	while (head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) > _mask)
+	{
+		if (!_block)
+		{
+			__atomic_add_fetch(&_dropped, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&_produce);
+			return ;
+		}
+		_waitRoom(head);
+	}
+	_fill(_ring[head & _mask], __atomic_load_n(&_now, __ATOMIC_RELAXED), level, format, data, length);
+	__atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&_produce);
+	_signal(_writerIdle, _notEmpty);
+}
+
+// ************************************************************************** //
+//                             Public Functions                               //
+// ************************************************************************** //
+
+/*
+** ringSize is rounded up to a power of two. With a binaryPath, every record
+** is appended to that file instead of stdout/stderr; each run starts with
+** the file magic, so the decoder knows format ids start over.
+*/
+void	Logger::start(size_t ringSize, bool blockWhenFull, const std::string &binaryPath)
+{
+	size_t	slots = 16;
+
+	if (_running)
+		return ;
+	if (!binaryPath.empty())
+	{
+		_binaryFd = open(binaryPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (_binaryFd < 0)
+			return error("Cannot open binary log " + binaryPath + ": " + strerror(errno));
+		_write(_binaryFd, LOG_FILE_MAGIC, LOG_FILE_MAGIC_SIZE);
+		info("Logging to binary log " + binaryPath);
+	}
+	while (slots < ringSize)
+		slots *= 2;
+	_ring = new Record[slots];
+	_mask = slots - 1;
+	_head = 0;
+	_tail = 0;
+	_block = blockWhenFull;
+	tick();
+	__atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+	if (pthread_create(&_writer, NULL, &Logger::_writerMain, NULL) != 0)
+	{
+		_running = false;
+		delete[] _ring;
+		_ring = NULL;
+		if (_binaryFd >= 0)
+			close(_binaryFd);
+		_binaryFd = -1;
+		error("Failed to start the log writer, logging synchronously");
+	}
+}
+
+/* Writes out whatever is still in the ring, then logs synchronously */
+void	Logger::stop(void)
+{
+	pthread_mutex_lock(&_produce);
+	bool	running = _running;
+	__atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&_produce);
+	if (!running)
+		return ;
+	pthread_mutex_lock(&_wake);
+	pthread_cond_signal(&_notEmpty);
+	pthread_mutex_unlock(&_wake);
+	pthread_join(_writer, NULL);
+	delete[] _ring;
+	_ring = NULL;
+	if (_binaryFd >= 0)
+		close(_binaryFd);
+	_binaryFd = -1;
+}
+
+void	Logger::tick(void) { __atomic_store_n(&_now, std::time(0), __ATOMIC_RELAXED); }
+
+void	Logger::log(LogLevel level, const std::string &message)
+{
+	_push(level, NULL, message.data(), message.size());
+}
+
+/* `format` must be a string literal: only its address is kept */
+void	Logger::log(LogLevel level, const char *format, const LogArgs &args)
+{
+	_push(level, format, args.data(), args.size());
+}
+
 // ************************************************************************** //
 //                            Non-member Functions                            //
 // ************************************************************************** //
 void info(const std::string& message) {
-    std::cout << GREEN << getCurrentTime() << " [INFO] " << message << RESET << std::endl;
+    Logger::log(LOG_INFO, message);
 }
 
 void error(const std::string& message) {
-    std::cerr << RED << getCurrentTime() << " [ERROR] " << message << RESET << std::endl;
+    Logger::log(LOG_ERROR, message);
 }
 
 void warning(const std::string& message) {
-    std::cout << YELLOW << getCurrentTime() << " [WARNING] " << message << RESET << std::endl;
-}
\ No newline at end of file
+    Logger::log(LOG_WARNING, message);
+}
@@ -107,7 +107,44 @@ int isValidPassword(const std::string& pwd)
     return (pwd.length() >= 4 && pwd.length() <= 6);
 }
 
-void sendMSG(int fd, std::string RPL)
+/*
+** A client over its SendQ ceiling gets nothing more queued; the owning loop
+** disconnects it when it gets to its dirty clients.
+*/
+static void	markQueued(Client &client)
 {
-	send(fd, RPL.c_str(), RPL.length(), MSG_DONTWAIT);
+	size_t	limit = client.getSendqLimit();
+
+	if (limit > 0 && client.queuedBytes() > limit)
+		client.setSendqExceeded(true);
+	client.getLoop()->markDirty(&client);
+}
+
+/*
+** Replies are corked: they are only queued here, and the owning event loop
+** writes everything a client got during the iteration with one sendmsg()
+** once the iteration's commands have all run.
+*/
+void sendMSG(Client &client, const std::string &RPL)
+{
+	if (client.isDisconnected() || client.isSendqExceeded())
+		return ;
+	client.getSendQueue().push(RPL);
+	markQueued(client);
+}
+
+void sendMSG(Client &client, SharedBuffer *RPL)
+{
+	if (client.isDisconnected() || client.isSendqExceeded())
+		return ;
+	client.getSendQueue().push(RPL);
+	markQueued(client);
+}
+
+void sendMSG(Client &client, const Reply &RPL)
+{
+	if (client.isDisconnected() || client.isSendqExceeded())
+		return ;
+	client.getSendQueue().push(RPL.data(), RPL.size());
+	markQueued(client);
 }
@@ -1,33 +1,72 @@
 #include "../include/irc.hpp"
 
-std::map<std::string, Command>  createCommandMap()
-{
-    std::map<std::string, Command> commandMap;
-    commandMap["USER"] = USER;
-    commandMap["NICK"] = NICK;
-    commandMap["JOIN"] = JOIN;
-    commandMap["INVITE"] = INVITE;
-    commandMap["KICK"] = KICK;
-    commandMap["MODE"] = MODE;
-    commandMap["TOPIC"] = TOPIC;
-    commandMap["PING"] = PING;
-    commandMap["QUIT"] = QUIT;
-    commandMap["OPER"] = OPER;
-    commandMap["PASS"] = PASS;
-    commandMap["PART"] = PART;
-    commandMap["PRIVMSG"] = PRIVMSG;
-    commandMap["KILL"] = KILL;
-    commandMap["DIE"] = DIE;
-    return commandMap;
-}
+/*
+** Command table indexed by a perfect hash of the command token: the first
+** and last letters (case folded) and the length, (first + 23 * last + length)
+** modulo 32, gives every command below its own slot. A new command needs a
+** free slot under that formula, or new constants.
+*/
+#define COMMAND_SLOTS 32
+#define REG CMD_REGISTERED
+#define OPR CMD_OPER
+
+static const CommandSpec	commandTable[COMMAND_SLOTS] = {
+	/*  0 */ {"PART", 4, PART, &MsgHandler::handlePART, 1, REG, 1},
+	/*  1 */ {"QUIT", 4, QUIT, &MsgHandler::handleQUIT, 0, 0, 1},
+	/*  2 */ {"INVITE", 6, INVITE, &MsgHandler::handleINVITE, 2, REG, 2},
+	/*  3 */ {"KILL", 4, KILL, &MsgHandler::handleKILL, 1, REG | OPR, 1},
+	/*  4 */ {"MODE", 4, MODE, &MsgHandler::handleMODE, 1, REG, 2},
+	/*  5 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/*  6 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/*  7 */ {"LUSERS", 6, LUSERS, &MsgHandler::handleLUSERS, 0, REG, 2},
+	/*  8 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/*  9 */ {"PASS", 4, PASS, &MsgHandler::handlePASS, 1, 0, 1},
+	/* 10 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 11 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 12 */ {"KICK", 4, KICK, &MsgHandler::handleKICK, 2, REG, 2},
+	/* 13 */ {"STATS", 5, STATS, &MsgHandler::handleSTATS, 0, REG | OPR, 4},
+	/* 14 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 15 */ {"NICK", 4, NICK, &MsgHandler::handleNICK, 0, 0, 3},
+	/* 16 */ {"JOIN", 4, JOIN, &MsgHandler::handleJOIN, 1, REG, 2},
+	/* 17 */ {"OPER", 4, OPER, &MsgHandler::handleOPER, 2, REG, 2},
+	/* 18 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 19 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 20 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 21 */ {"PING", 4, PING, &MsgHandler::handlePING, 0, 0, 1},
+	/* 22 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 23 */ {"USER", 4, USER, &MsgHandler::handleUSER, 4, 0, 1},
+	/* 24 */ {"PRIVMSG", 7, PRIVMSG, &MsgHandler::handlePRIVMSG, 2, REG, 1},
+	/* 25 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 26 */ {"DIE", 3, DIE, &MsgHandler::handleDIE, 0, REG | OPR, 1},
+	/* 27 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 28 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 29 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+	/* 30 */ {"TOPIC", 5, TOPIC, &MsgHandler::handleTOPIC, 1, REG, 2},
+	/* 31 */ {NULL, 0, UNKNOWN, NULL, 0, 0, 0},
+};
 
-Command getCommandType(const std::string& cmd)
+/*
+** Commands are case-insensitive. Returns NULL for an unknown token.
+*/
+const CommandSpec	*findCommand(const StringView &token)
 {
-    static const std::map<std::string, Command> commandMap = createCommandMap();
-	std::map<std::string, Command>::const_iterator it = commandMap.find(cmd);
+	if (token.empty())
+		return (NULL);
+	unsigned char	first = std::toupper(static_cast<unsigned char>(token.data[0]));
+	unsigned char	last = std::toupper(static_cast<unsigned char>(token.data[token.size - 1]));
+	const CommandSpec	&spec = commandTable[(first + 23 * last + token.size) % COMMAND_SLOTS];
 
-    if (it == commandMap.end())
-    	return UNKNOWN;
-    return it->second;
+	if (spec.length != token.size || strncasecmp(spec.name, token.data, token.size) != 0)
+		return (NULL);
+	return (&spec);
 }
 
+const char	*commandName(Command type)
+{
+	for (size_t i = 0; i < COMMAND_SLOTS; i++)
+	{
+		if (commandTable[i].name && commandTable[i].type == type)
+			return (commandTable[i].name);
+	}
+	return ("UNKNOWN");
+}